@@ -0,0 +1,177 @@
+#!/bin/sh
+#
+# Compiler benchmark: compiles the workloads listed in bench/compile_workloads.txt
+# with -O0 and -O1 at every cell type listed, and compares the compile time, the
+# peak memory usage of bfx, the size of the generated code, the number of cells
+# it requires and the number of steps it takes to run in bfint with the baseline
+# stored in bench/compile_baseline.txt.
+#
+# Usage (from the root of the repository, or through "make bench-compile"):
+#     sh bench/compile.sh            run the benchmark and compare to the baseline
+#     sh bench/compile.sh --update   run the benchmark and overwrite the baseline
+#
+# Environment:
+#     BENCH_REPEAT          number of times each program is compiled, the fastest
+#                           counts (1)
+#     BENCH_THRESHOLD       regression threshold for the compile time and peak
+#                           memory usage, in percent (10). Compile times are
+#                           only flagged when they increase by at least 0.05s
+#                           as well, to filter out noise on short runs.
+#     BENCH_SIZE_THRESHOLD  regression threshold for the code size, cells and
+#                           steps, in percent (0)
+#     BFX, BFINT            compiler and interpreter to use (./bfx and ./bfint)
+#
+# All metrics of bfx are taken from the profile it writes with --profile. The
+# code size, cells and steps are deterministic, so by default any increase is
+# reported as a regression. The output of every program that is run is compared
+# as well: a change is reported as an error. Programs are run with the random
+# extension enabled, a fixed seed and random numbers up to 255 (larger ones make
+# the arithmetic on them take very long with 16- and 32-bit cells).
+
+BFX=${BFX:-./bfx}
+BFINT=${BFINT:-./bfint}
+REPEAT=${BENCH_REPEAT:-1}
+THRESHOLD=${BENCH_THRESHOLD:-10}
+SIZE_THRESHOLD=${BENCH_SIZE_THRESHOLD:-0}
+SEED=1
+
+WORKLOADS=bench/compile_workloads.txt
+BASELINE=bench/compile_baseline.txt
+
+update=0
+if [ "$#" -gt 0 ]; then
+    if [ "$1" = "--update" ]; then
+        update=1
+    else
+        echo "Usage: $0 [--update]" >&2
+        exit 2
+    fi
+fi
+
+for prog in "$BFX" "$BFINT"; do
+    if [ ! -x "$prog" ]; then
+        echo "$prog not found: build it first (make bfx bfint)." >&2
+        exit 2
+    fi
+done
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/bfx-bench.XXXXXX") || exit 2
+trap 'rm -rf "$work"' EXIT INT TERM
+
+results=$work/results.txt
+status=0
+
+# Extract the value following "label:" from the profile written by bfx
+profileValue() {
+    sed -n "s/^$1: *\([0-9.]*\).*/\1/p" "$work/profile.txt"
+}
+
+printf '%-14s %-3s %-6s %9s %9s %8s %6s %11s  %s\n' \
+       workload opt type "time (s)" "RSS (kB)" ops cells steps "vs. baseline"
+
+grep -v '^[[:space:]]*\(#\|$\)' "$WORKLOADS" |
+while read -r name source input flags types; do
+    [ "$flags" = "-" ] && flags=
+
+    for opt in O0 O1; do
+        for type in $types; do
+            label="$name -$opt $type"
+            bf=$work/$name.bf
+
+            # Compile, keeping the fastest of REPEAT runs
+            best=
+            run=0
+            while [ "$run" -lt "$REPEAT" ]; do
+                # $flags is intentionally unquoted: it may hold several options
+                if ! "$BFX" -"$opt" -t "$type" $flags -I std -I bench -I bfx_examples \
+                     --profile "$work/profile.txt" -o "$bf" "$source" \
+                     > "$work/bfx.log" 2>&1; then
+                    echo "$label: compilation failed:" >&2
+                    cat "$work/bfx.log" >&2
+                    exit 1
+                fi
+
+                seconds=$(profileValue "Compilation time")
+                if [ -z "$best" ] || awk -v s="$seconds" -v b="$best" 'BEGIN { exit !(s < b) }'; then
+                    best=$seconds
+                fi
+                run=$((run + 1))
+            done
+
+            rss=$(profileValue "Peak memory usage")
+            ops=$(profileValue "Number of BF operations generated")
+            cells=$(profileValue "Number of cells required")
+
+            # Run
+            steps=-
+            sum=-
+            if [ "$input" != "compile" ]; then
+                in=$input
+                [ "$in" = "-" ] && in=/dev/null
+                if ! "$BFINT" -t "$type" --random --rand-max 255 --seed "$SEED" \
+                     --stats-json "$work/stats.json" \
+                     "$bf" < "$in" > "$work/out" 2> "$work/bfint.log"; then
+                    echo "$label: bfint failed:" >&2
+                    cat "$work/bfint.log" >&2
+                    exit 1
+                fi
+
+                steps=$(sed -n 's/^  "steps": \([0-9]*\),$/\1/p' "$work/stats.json")
+                sum=$(cksum < "$work/out" | awk '{ print $1 }')
+            fi
+
+            echo "$name $opt $type $best $rss $ops $cells $steps $sum" >> "$results"
+
+            # Compare to the baseline
+            verdict="-"
+            base=$(awk -v n="$name" -v o="$opt" -v t="$type" \
+                       '$1 == n && $2 == o && $3 == t' "$BASELINE" 2>/dev/null)
+            if [ -n "$base" ]; then
+                verdict=$(echo "$base" |
+                          awk -v time="$best" -v rss="$rss" -v ops="$ops" -v cells="$cells" \
+                              -v steps="$steps" -v sum="$sum" \
+                              -v th="$THRESHOLD" -v sth="$SIZE_THRESHOLD" '
+                    function change(what, new, old, limit, minimum) {
+                        if (old == "-" || old == 0 || new == old)
+                            return;
+                        pct = (new - old) * 100 / old;
+                        v = v sprintf("%s%s %+g (%+.1f%%)", (v == "" ? "" : ", "), what, new - old, pct);
+                        if (pct > limit && new - old >= minimum)
+                            v = v " REGRESSION";
+                    }
+                    {
+                        v = "";
+                        change("time", time, $4, th, 0.05);
+                        change("rss", rss, $5, th, 0);
+                        change("ops", ops, $6, sth, 0);
+                        change("cells", cells, $7, sth, 0);
+                        change("steps", steps, $8, sth, 0);
+                        if (sum != $9)
+                            v = v (v == "" ? "" : ", ") "OUTPUT MISMATCH";
+                        print (v == "" ? "=" : v);
+                    }')
+            fi
+
+            printf '%-14s %-3s %-6s %9s %9s %8s %6s %11s  %s\n' \
+                   "$name" "$opt" "$type" "$best" "$rss" "$ops" "$cells" "$steps" "$verdict"
+
+            case "$verdict" in
+                *MISMATCH*|*REGRESSION*) touch "$work/failed" ;;
+            esac
+        done
+    done
+done || exit 1
+
+if [ "$update" -eq 1 ]; then
+    {
+        echo "# Baseline for bench/compile.sh, regenerate with: make bench-compile-baseline"
+        echo "# workload opt type compile_s max_rss_kb ops cells steps output_cksum"
+        cat "$results"
+    } > "$BASELINE"
+    echo "Baseline written to $BASELINE."
+elif [ -e "$work/failed" ]; then
+    echo "Regressions beyond the thresholds (or changed output) found." >&2
+    status=1
+fi
+
+exit $status
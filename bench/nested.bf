@@ -0,0 +1,9 @@
+Nested loop workload
+
+Six levels of nested counting loops of fifteen iterations each; the innermost
+body adds one and two to the two cells that follow it (about eleven million
+times) The final values of those cells are printed followed by a newline
+Exercises the branch handling and the dispatch loop of an interpreter rather
+than the code generated by the compiler
+
++++++++++++++++[>+++++++++++++++[>+++++++++++++++[>+++++++++++++++[>+++++++++++++++[>+++++++++++++++[>+>++<<-]<-]<-]<-]<-]<-]>>>>>>.>.>++++++++++.
@@ -0,0 +1,184 @@
+#!/bin/sh
+#
+# Benchmark suite: compiles the workloads listed in bench/workloads.txt, runs
+# them in bfint at every cell type listed and compares the throughput (executed
+# BF-instructions per second), wall time and peak memory usage with the baseline
+# stored in bench/baseline.txt.
+#
+# Usage (from the root of the repository, or through "make bench"):
+#     sh bench/run.sh            run the suite and compare to the baseline
+#     sh bench/run.sh --update   run the suite and overwrite the baseline
+#
+# Environment:
+#     BENCH_REPEAT     number of timed runs per workload, the fastest counts (3)
+#     BENCH_THRESHOLD  regression threshold in percent (10)
+#     BFX, BFINT       compiler and interpreter to use (./bfx and ./bfint)
+#
+# Every program is run once with --stats-json to count the steps, and
+# BENCH_REPEAT times without it to measure the wall time and, through --rss-out,
+# the peak RSS (counting needs extra memory, which would inflate it). All runs
+# use the same input and RNG-seed, so the number of steps and the output are
+# deterministic: a change in output is reported as an error, a change in the
+# number of steps is reported for information (it changes with the compiler).
+#
+# Throughput and RSS depend on the machine, so the baseline records the host it
+# was made on. When it was made on a different host, they are only shown and
+# not judged: regenerate the baseline on every machine the suite runs on.
+
+BFX=${BFX:-./bfx}
+BFINT=${BFINT:-./bfint}
+REPEAT=${BENCH_REPEAT:-3}
+THRESHOLD=${BENCH_THRESHOLD:-10}
+SEED=1
+
+WORKLOADS=bench/workloads.txt
+BASELINE=bench/baseline.txt
+
+update=0
+if [ "$#" -gt 0 ]; then
+    if [ "$1" = "--update" ]; then
+        update=1
+    else
+        echo "Usage: $0 [--update]" >&2
+        exit 2
+    fi
+fi
+
+for prog in "$BFX" "$BFINT"; do
+    if [ ! -x "$prog" ]; then
+        echo "$prog not found: build it first (make bfx bfint)." >&2
+        exit 2
+    fi
+done
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/bfx-bench.XXXXXX") || exit 2
+trap 'rm -rf "$work"' EXIT INT TERM
+
+now() {
+    date +%s%N
+}
+
+# Identifies the machine the numbers are measured on
+hostId() {
+    cpu=$(sed -n 's/^model name[[:space:]]*: *//p' /proc/cpuinfo 2>/dev/null | head -n 1)
+    echo "$(uname -sm)${cpu:+, $cpu}"
+}
+
+host=$(hostId)
+perf=1
+baseHost=$(sed -n 's/^# host: //p' "$BASELINE" 2>/dev/null)
+if [ "$update" -eq 0 ] && [ -e "$BASELINE" ] && [ "$baseHost" != "$host" ]; then
+    echo "Note: $BASELINE was made on another host (${baseHost:-unknown}); throughput and" >&2
+    echo "RSS are not compared. Regenerate it on this machine with: make bench-baseline" >&2
+    perf=0
+fi
+
+results=$work/results.txt
+status=0
+
+printf '%-12s %-6s %12s %10s %10s %9s  %s\n' \
+       workload type steps "wall (s)" "Mops/s" "RSS (kB)" "vs. baseline"
+
+grep -v '^[[:space:]]*\(#\|$\)' "$WORKLOADS" |
+while read -r name source input types; do
+    for type in $types; do
+        label="$name $type"
+
+        # Compile
+        case "$source" in
+            *.bfx)
+                bf=$work/$name.$type.bf
+                if ! "$BFX" -t "$type" -I bench -I std -o "$bf" "$source" \
+                     > "$work/bfx.log" 2>&1; then
+                    echo "$label: compilation failed:" >&2
+                    cat "$work/bfx.log" >&2
+                    exit 1
+                fi
+                ;;
+            *)
+                bf=$source
+                ;;
+        esac
+
+        [ "$input" = "-" ] && input=/dev/null
+
+        # Counting run: steps and output
+        if ! "$BFINT" -t "$type" --seed "$SEED" --stats-json "$work/stats.json" "$bf" \
+             < "$input" > "$work/out" 2> "$work/bfint.log"; then
+            echo "$label: bfint failed:" >&2
+            cat "$work/bfint.log" >&2
+            exit 1
+        fi
+
+        steps=$(sed -n 's/^  "steps": \([0-9]*\),$/\1/p' "$work/stats.json")
+        sum=$(cksum < "$work/out" | awk '{ print $1 }')
+
+        # Timed runs: keep the fastest time and the lowest peak RSS
+        best=
+        rss=
+        run=0
+        while [ "$run" -lt "$REPEAT" ]; do
+            start=$(now)
+            "$BFINT" -t "$type" --seed "$SEED" --rss-out "$work/rss.txt" "$bf" \
+                < "$input" > /dev/null 2>&1
+            end=$(now)
+            ns=$((end - start))
+            if [ -z "$best" ] || [ "$ns" -lt "$best" ]; then
+                best=$ns
+            fi
+            kb=$(cat "$work/rss.txt")
+            if [ -z "$rss" ] || [ "$kb" -lt "$rss" ]; then
+                rss=$kb
+            fi
+            run=$((run + 1))
+        done
+
+        wall=$(awk -v ns="$best" 'BEGIN { printf "%.4f", ns / 1e9 }')
+        ops=$(awk -v s="$steps" -v ns="$best" 'BEGIN { printf "%.0f", s * 1e9 / ns }')
+        echo "$name $type $steps $ops $rss $sum" >> "$results"
+
+        # Compare to the baseline
+        verdict="-"
+        base=$(awk -v n="$name" -v t="$type" '$1 == n && $2 == t' "$BASELINE" 2>/dev/null)
+        if [ -n "$base" ]; then
+            verdict=$(echo "$base" |
+                      awk -v steps="$steps" -v ops="$ops" -v rss="$rss" -v sum="$sum" \
+                          -v th="$THRESHOLD" -v perf="$perf" '
+                {
+                    v = sprintf("%+.1f%% ops/s", (ops - $4) * 100 / $4);
+                    if (sum != $6)
+                        v = v ", OUTPUT MISMATCH";
+                    else if (perf && ops < $4 * (100 - th) / 100)
+                        v = v ", REGRESSION";
+                    if (perf && rss > $5 * (100 + th) / 100)
+                        v = v ", RSS REGRESSION (" $5 " kB)";
+                    if (steps != $3)
+                        v = v sprintf(", steps %+.1f%%", (steps - $3) * 100 / $3);
+                    print v;
+                }')
+        fi
+
+        printf '%-12s %-6s %12s %10s %10.2f %9s  %s\n' \
+               "$name" "$type" "$steps" "$wall" \
+               "$(awk -v o="$ops" 'BEGIN { print o / 1e6 }')" "$rss" "$verdict"
+
+        case "$verdict" in
+            *MISMATCH*|*REGRESSION*) touch "$work/failed" ;;
+        esac
+    done
+done || exit 1
+
+if [ "$update" -eq 1 ]; then
+    {
+        echo "# Baseline for bench/run.sh, regenerate with: make bench-baseline"
+        echo "# host: $host"
+        echo "# workload type steps ops_per_sec max_rss_kb output_cksum"
+        cat "$results"
+    } > "$BASELINE"
+    echo "Baseline written to $BASELINE."
+elif [ -e "$work/failed" ]; then
+    echo "Regressions beyond the threshold of $THRESHOLD% (or changed output) found." >&2
+    status=1
+fi
+
+exit $status
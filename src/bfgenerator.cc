@@ -35,6 +35,55 @@ std::string BFGenerator::setToValue(int const start, int const val, size_t const
     return ops.str();
 }
 
+std::string BFGenerator::setToValues(int const start, std::vector<int> const &values, int const base)
+{
+    validateAddr(start);
+
+    std::ostringstream ops;
+    if (base == 0)
+    {
+        for (size_t i = 0; i != values.size(); ++i)
+            ops << setToValue(start + i, values[i]);
+
+        return ops.str();
+    }
+
+    // Shared base: a loop that runs base times adds a multiple of the base to
+    // each cell, after which every cell only needs a small correction.
+    int const n = values.size();
+    int const counter = f_getTemp(near(start, start + n - 1));
+    ops << setToValue(start, 0, n)
+        << setToValue(counter, base)
+        << "[";
+
+    for (int i = 0; i != n; ++i)
+    {
+        if (int const k = multiplier(values[i], base))
+            ops << addConst(start + i, k);
+    }
+
+    ops <<     decr(counter)
+        << "]";
+
+    for (int i = 0; i != n; ++i)
+    {
+        if (int const delta = values[i] - multiplier(values[i], base) * base)
+            ops << addConst(start + i, delta);
+    }
+
+    return ops.str();
+}
+
+int BFGenerator::multiplier(int const val, int const base)
+{
+    // Number of times the base is added to a cell that should end up with val,
+    // chosen such that the remaining correction and the multiple itself are cheap.
+    int const k = val / base;
+    int const down = k + (val - k * base);
+    int const up   = (k + 1) + ((k + 1) * base - val);
+    return (up < down) ? k + 1 : k;
+}
+
 std::string BFGenerator::setToValuePlus(int const addr, int const val, size_t const n)
 {
     validateAddr(addr);
@@ -63,6 +112,48 @@ std::string BFGenerator::print(int const addr)
     return ops.str();
 }
 
+std::string BFGenerator::printValues(int const scratch, std::vector<int> const &values)
+{
+    // Every character is printed from the same cell, which only has to be adjusted
+    // by the difference with the previous one.
+    
+    validateAddr(scratch);
+
+    long const mod = d_maxCellValue + 1;
+    int current = 0;
+    std::ostringstream ops;
+    ops << setToValue(scratch, 0);
+    for (int const val: values)
+    {
+        long const diff = (((val - current) % mod) + mod) % mod;
+        ops << addConst(scratch, (diff <= mod - diff) ? diff : diff - mod)
+            << '.';
+        current = val;
+    }
+
+    return ops.str();
+}
+
+std::string BFGenerator::printString(int const start, int const n)
+{
+    // The string is copied into a buffer between two zero-cells. The pointer runs
+    // over the buffer printing every cell until it finds the terminating zero,
+    // and returns to the start of the buffer in the same way.
+    
+    validateAddr(start);
+
+    int const buf = f_getTempBlock(n + 2, near(start, start + n));
+    std::ostringstream ops;
+    ops << setToValue(buf, 0)
+        << setToValue(buf + n + 1, 0)
+        << assign(buf + 1, start, n)
+        << movePtr(buf + 1)
+        << "[.>]<[<]";
+
+    d_pointer = buf;
+    return ops.str();
+}
+
 std::string BFGenerator::random(int const addr)
 {
     std::ostringstream ops;
@@ -75,8 +166,10 @@ std::string BFGenerator::random(int const addr)
 std::string BFGenerator::assign(int const lhs, int const rhs)
 {
     validateAddr(lhs, rhs);
+    if (lhs == rhs)
+        return movePtr(lhs);
     
-    int const tmp = f_getTemp();
+    int const tmp = f_getTemp(near(lhs, rhs));
         
     std::ostringstream ops;
     ops    << setToValue(lhs, 0)
@@ -103,6 +196,98 @@ std::string BFGenerator::assign(int const lhs, int const rhs)
     return ops.str();
 }
 
+std::string BFGenerator::assign(int const lhs, int const rhs, size_t const n)
+{
+    validateAddr(lhs, rhs);
+    if (n == 1)
+        return assign(lhs, rhs);
+    if (lhs == rhs)
+        return movePtr(lhs);
+
+    std::ostringstream ops;
+    if (std::abs(lhs - rhs) < (int)n)
+    {
+        // Overlapping blocks -> copy cell by cell
+        for (size_t i = 0; i != n; ++i)
+            ops << assign(lhs + i, rhs + i);
+
+        return ops.str();
+    }
+
+    // Copy n contiguous cells in sweeps over a lane of scratch cells. The source
+    // is first moved into both the target and the lane, and then restored from the
+    // lane. A zero cell only costs a single step of each sweep, instead of a trip
+    // between source, target and scratch cell.
+    size_t const laneSize = std::min(n, MAX_COPY_LANE);
+    int const lane = f_getTempBlock(laneSize, near(rhs, rhs + (int)laneSize));
+
+    ops << setToValue(lhs, 0, n)
+        << setToValue(lane, 0, laneSize);
+
+    for (size_t begin = 0; begin < n; begin += laneSize)
+    {
+        size_t const end = std::min(n, begin + laneSize);
+        for (size_t i = begin; i != end; ++i)
+        {
+            ops << movePtr(rhs + i)
+                << "["
+                <<     incr(lhs + i)
+                <<     incr(lane + i - begin)
+                <<     decr(rhs + i)
+                << "]";
+        }
+
+        for (size_t i = begin; i != end; ++i)
+        {
+            ops << movePtr(lane + i - begin)
+                << "["
+                <<     incr(rhs + i)
+                <<     decr(lane + i - begin)
+                << "]";
+        }
+    }
+
+    ops << movePtr(lhs);
+    return ops.str();
+}
+
+std::string BFGenerator::fill(int const start, size_t const n, int const rhs)
+{
+    validateAddr(start, rhs);
+
+    std::ostringstream ops;
+    if (rhs >= start && rhs < start + (int)n)
+    {
+        // Source is part of the target -> copy cell by cell
+        for (size_t i = 0; i != n; ++i)
+            ops << assign(start + i, rhs);
+
+        return ops.str();
+    }
+
+    // A single loop distributes the source over all target cells at once
+    int const tmp = f_getTemp(near(rhs));
+    ops << setToValue(start, 0, n)
+        << setToValue(tmp, 0)
+        << movePtr(rhs)
+        << "[";
+
+    for (size_t i = 0; i != n; ++i)
+        ops << incr(start + i);
+
+    ops <<     incr(tmp)
+        <<     decr(rhs)
+        << "]"
+        << movePtr(tmp)
+        << "["
+        <<     incr(rhs)
+        <<     decr(tmp)
+        << "]"
+        << movePtr(start);
+
+    return ops.str();
+}
+
 std::string BFGenerator::movePtr(int const addr)
 {
     validateAddr(addr);
@@ -129,7 +314,7 @@ std::string BFGenerator::addTo(int const target, int const rhs)
     validateAddr(target, rhs);
     
     std::ostringstream ops;
-    int const tmp = f_getTemp();
+    int const tmp = f_getTemp(near(target, rhs));
     ops    << assign(tmp, rhs)
            << "["
            <<     incr(target)
@@ -144,7 +329,7 @@ std::string BFGenerator::subtractFrom(int const target, int const rhs)
 {
     validateAddr(target, rhs);
     
-    int const tmp = f_getTemp();
+    int const tmp = f_getTemp(near(target, rhs));
     std::ostringstream ops;
     ops    << assign(tmp, rhs)
            << "["
@@ -195,7 +380,7 @@ std::string BFGenerator::multiplyBy(int const target, int const factor)
 {
     validateAddr(target, factor);
 
-    int const tmp = f_getTempBlock(2);
+    int const tmp = f_getTempBlock(2, near(target, factor));
     int const targetCopy = tmp + 0;
     int const count      = tmp + 1;
 
@@ -227,7 +412,7 @@ std::string BFGenerator::powerBy(int const base, int const pow)
 {
     validateAddr(base, pow);
     
-    int const tmp = f_getTempBlock(2);
+    int const tmp = f_getTempBlock(2, near(base, pow));
     int const baseCopy = tmp + 0;
     int const powCopy = tmp + 1;
     
@@ -250,7 +435,7 @@ std::string BFGenerator::logicalNot(int const addr, int const result)
 {
     validateAddr(addr, result);
     
-    int const tmp = f_getTemp();
+    int const tmp = f_getTemp(near(addr, result));
     std::ostringstream ops;
     
     ops    << setToValue(result, 1)
@@ -268,7 +453,7 @@ std::string BFGenerator::logicalNot(int const addr)
 {
     validateAddr(addr);
     
-    int flag = f_getTemp();
+    int flag = f_getTemp(near(addr));
     
     std::ostringstream ops;
     ops    << setToValue(flag, 1)
@@ -291,7 +476,7 @@ std::string BFGenerator::logicalAnd(int const lhs, int const rhs, int const resu
 {
     validateAddr(lhs, rhs, result);
 
-    int const tmp = f_getTempBlock(2);
+    int const tmp = f_getTempBlock(2, near(lhs, rhs, result));
     int const x = tmp + 0;
     int const y = tmp + 1;
     
@@ -316,7 +501,7 @@ std::string BFGenerator::logicalAnd(int const lhs, int const rhs)
 {
     validateAddr(lhs, rhs);
 
-    int const result = f_getTemp();
+    int const result = f_getTemp(near(lhs, rhs));
     
     std::ostringstream ops;
     ops    << logicalAnd(lhs, rhs, result)
@@ -330,7 +515,7 @@ std::string BFGenerator::logicalOr(int const lhs, int const rhs, int const resul
 {
     validateAddr(lhs, rhs, result);
 
-    int const tmp = f_getTempBlock(2);
+    int const tmp = f_getTempBlock(2, near(lhs, rhs, result));
     int const x = tmp + 0;
     int const y = tmp + 1;
 
@@ -355,7 +540,7 @@ std::string BFGenerator::logicalOr(int const lhs, int const rhs)
 {
     validateAddr(lhs, rhs);
 
-    int const result = f_getTemp();
+    int const result = f_getTemp(near(lhs, rhs));
     
     std::ostringstream ops;
     ops    << logicalOr(lhs, rhs, result)
@@ -368,7 +553,7 @@ std::string BFGenerator::equal(int const lhs, int const rhs, int const result)
 {
     validateAddr(lhs, rhs, result);
 
-    int const tmp = f_getTempBlock(6);
+    int const tmp = f_getTempBlock(6, near(lhs, rhs, result));
     int const x = tmp + 0;
     int const y = tmp + 1;
     int const underflow1 = tmp + 2;
@@ -412,7 +597,7 @@ std::string BFGenerator::notEqual(int const lhs, int const rhs, int const result
 {
     validateAddr(lhs, rhs, result);
     
-    int const isEqual = f_getTemp();
+    int const isEqual = f_getTemp(near(lhs, rhs, result));
     std::ostringstream ops;
     ops << equal(lhs, rhs, isEqual)
         << logicalNot(isEqual, result);
@@ -424,7 +609,7 @@ std::string BFGenerator::greater(int const lhs, int const rhs, int const result)
 {
     validateAddr(lhs, rhs, result);
 
-    int const tmp  = f_getTempBlock(3);
+    int const tmp  = f_getTempBlock(3, near(lhs, rhs, result));
     int const x    = tmp + 0;
     int const y    = tmp + 1;
     int const underflow = tmp + 2;
@@ -460,7 +645,7 @@ std::string BFGenerator::greaterOrEqual(int const lhs, int const rhs, int const
 {
     validateAddr(lhs, rhs, result);
 
-    int const tmp       = f_getTempBlock(2);
+    int const tmp       = f_getTempBlock(2, near(lhs, rhs, result));
     int const isEqual   = tmp + 0;
     int const isGreater = tmp + 1;
 
@@ -479,12 +664,14 @@ std::string BFGenerator::lessOrEqual(int const lhs, int const rhs, int const res
     return greaterOrEqual(rhs, lhs, result); // reverse arguments
 }
 
-std::string BFGenerator::fetchElement(int const arrStart, int const arrSize, int const index, int const ret)
+std::string BFGenerator::fetchElement(int const arrStart, int const arrSize, int const index, int const ret, int const offset)
 {
     // Algorithms to move an unknown amount to the left and right.
     // Assumes the pointer points to a cell containing the amount
     // it needs to be shifted and a copy of this amount adjacent to it.
     // Also, neighboring cells must all be zeroed out.
+    // When only part of an array can be indexed, arrStart and arrSize describe
+    // this slice and offset is the index of its first element.
                
     static std::string const dynamicMoveRight = "[>[->+<]<[->+<]>-]";
     static std::string const dynamicMoveLeft  = "[<[-<+>]>[-<+>]<-]<";
@@ -495,7 +682,7 @@ std::string BFGenerator::fetchElement(int const arrStart, int const arrSize, int
     // 3. to prevent overflow on off-by-one errors
 
     int const bufSize = arrSize + 3;
-    int const buf = f_getTempBlock(bufSize);
+    int const buf = f_getTempBlock(bufSize, near(arrStart));
     int const dist = buf - arrStart;
 
     std::string const arr2buf(std::abs(dist), (dist > 0 ? '>' : '<'));
@@ -503,6 +690,7 @@ std::string BFGenerator::fetchElement(int const arrStart, int const arrSize, int
 
     std::ostringstream ops;
     ops << assign(buf + 0, index)
+        << (offset ? addConst(buf + 0, -offset) : "")
         << assign(buf + 1, buf)
         << setToValue(buf + 2, 0, bufSize - 2)
         << movePtr(buf)
@@ -529,13 +717,13 @@ std::string BFGenerator::fetchElement(int const arrStart, int const arrSize, int
     return ops.str();
 }
 
-std::string BFGenerator::assignElement(int const arrStart, int const arrSize, int const index, int const val)
+std::string BFGenerator::assignElement(int const arrStart, int const arrSize, int const index, int const val, int const offset)
 {
     static std::string const dynamicMoveRight = "[>>[->+<]<[->+<]<[->+<]>-]";
     static std::string const dynamicMoveLeft = "[[-<+>]<-]<";
                
     int const bufSize = arrSize + 3;
-    int const buf     = f_getTempBlock(bufSize);
+    int const buf     = f_getTempBlock(bufSize, near(arrStart));
     int const dist    = buf - arrStart;
 
     std::string const arr2buf(std::abs(dist), (dist > 0 ? '>' : '<'));
@@ -543,6 +731,7 @@ std::string BFGenerator::assignElement(int const arrStart, int const arrSize, in
 
     std::ostringstream ops;
     ops << assign(buf, index)
+        << (offset ? addConst(buf, -offset) : "")
         << assign(buf + 1, buf)
         << assign(buf + 2, val)
         << setToValue(buf + 3, 0, bufSize - 3)
@@ -567,7 +756,7 @@ std::string BFGenerator::assignElement(int const arrStart, int const arrSize, in
 
 std::string BFGenerator::divmod(int const num, int const denom, int const divResult, int const modResult)
 {
-    int const tmp = f_getTempBlock(4);
+    int const tmp = f_getTempBlock(4, near(num, denom, divResult, modResult));
     int const tmp_loopflag  = tmp + 0;
     int const tmp_zeroflag  = tmp + 1;
     int const tmp_num       = tmp + 2;
@@ -576,7 +765,8 @@ std::string BFGenerator::divmod(int const num, int const denom, int const divRes
     // Algorithm:
     // 1. Initialize result-cells to 0 and copy operands to temps
     // 2. In case the denominator is 0 (divide by zero), set the result to 255 (~inf)
-    //    Set the loopflag to 0 in order to skip the calculating loop.
+    //    (by decrementing it from 0). Set the loopflag to 0 in order to skip the
+    //    calculating loop.
     // 3. In case the numerator is 0, the result of division is also zero. Set the remainder
     //    to the same value as the denominator.
     // 4. Enter the loop:
@@ -597,8 +787,8 @@ std::string BFGenerator::divmod(int const num, int const denom, int const divRes
         << logicalNot(denom, tmp_zeroflag)
         << "["                                      // 2
         <<     setToValue(tmp_loopflag, 0)
-        <<     setToValue(divResult, d_maxCellValue)
-        <<     setToValue(modResult, d_maxCellValue)
+        <<     setToValue(divResult, 0) << "-"
+        <<     setToValue(modResult, 0) << "-"
         <<     setToValue(tmp_zeroflag, 0)
         << "]"
         << logicalNot(num, tmp_zeroflag)
@@ -630,3 +820,983 @@ std::string BFGenerator::divmod(int const num, int const denom, int const divRes
 
     return ops.str();
 }
+
+int BFGenerator::bits() const
+{
+    int n = 0;
+    for (size_t val = d_maxCellValue; val != 0; val >>= 1)
+        ++n;
+
+    return n;
+}
+
+std::string BFGenerator::halve(int const x, int const tmp)
+{
+    // Divides x by 2, using 3 cells starting at tmp. On return, tmp + 0 holds the
+    // remainder (lowest bit).
+    
+    int const bit = tmp + 0;
+    int const quot = tmp + 1;
+    int const flag = tmp + 2;
+    
+    std::ostringstream ops;
+    ops    << setToValue(tmp, 0, 3)
+           << movePtr(x)
+           << "["
+           <<     decr(x)
+           <<     incr(flag)
+           <<     movePtr(bit)
+           <<     "["
+           <<         decr(bit)
+           <<         incr(quot)
+           <<         decr(flag)
+           <<         movePtr(bit)
+           <<     "]"
+           <<     movePtr(flag)
+           <<     "["
+           <<         decr(flag)
+           <<         incr(bit)
+           <<         movePtr(flag)
+           <<     "]"
+           <<     movePtr(x)
+           << "]"
+           << movePtr(quot)
+           << "["
+           <<     decr(quot)
+           <<     incr(x)
+           <<     movePtr(quot)
+           << "]";
+
+    return ops.str();
+}
+
+std::string BFGenerator::twice(int const x, int const tmp)
+{
+    std::ostringstream ops;
+    ops    << setToValue(tmp, 0)
+           << movePtr(x)
+           << "["
+           <<     decr(x)
+           <<     incr(tmp)
+           <<     incr(tmp)
+           <<     movePtr(x)
+           << "]"
+           << movePtr(tmp)
+           << "["
+           <<     decr(tmp)
+           <<     incr(x)
+           <<     movePtr(tmp)
+           << "]";
+
+    return ops.str();
+}
+
+std::string BFGenerator::bitwise(int const lhs, int const rhs, int const result, BitCombiner const &combine)
+{
+    // Both operands are taken apart bit by bit, lowest bit first, by repeatedly
+    // halving them. The bits of the result are combined into a number again from
+    // the highest bit down, by doubling.
+    
+    validateAddr(lhs, rhs, result);
+
+    int const n = bits();
+    int const tmp = f_getTempBlock(8 + n, near(lhs, rhs, result));
+    int const x = tmp + 0;
+    int const y = tmp + 1;
+    int const xBit = tmp + 2;
+    int const yBit = tmp + 5;
+    int const out = tmp + 8;
+    
+    std::ostringstream ops;
+    ops << assign(x, lhs)
+        << assign(y, rhs)
+        << setToValue(out, 0, n);
+
+    for (int i = 0; i != n; ++i)
+    {
+        ops << halve(x, xBit)
+            << halve(y, yBit)
+            << combine(xBit, yBit, out + i, xBit + 1);
+    }
+
+    ops << setToValue(result, 0);
+    for (int i = n - 1; i >= 0; --i)
+    {
+        ops << twice(result, x)
+            << movePtr(out + i)
+            << "["
+            <<     decr(out + i)
+            <<     incr(result)
+            <<     movePtr(out + i)
+            << "]";
+    }
+
+    ops << movePtr(result);
+    return ops.str();
+}
+
+std::string BFGenerator::bitAnd(int const lhs, int const rhs, int const result)
+{
+    return bitwise(lhs, rhs, result,
+                   [this](int const x, int const y, int const res, int const){
+                       std::ostringstream ops;
+                       ops    << movePtr(x)
+                              << "["
+                              <<     decr(x)
+                              <<     movePtr(y)
+                              <<     "["
+                              <<         decr(y)
+                              <<         incr(res)
+                              <<         movePtr(y)
+                              <<     "]"
+                              <<     movePtr(x)
+                              << "]"
+                              << setToValue(y, 0);
+                       return ops.str();
+                   });
+}
+
+std::string BFGenerator::bitOr(int const lhs, int const rhs, int const result)
+{
+    return bitwise(lhs, rhs, result,
+                   [this](int const x, int const y, int const res, int const tmp){
+                       std::ostringstream ops;
+                       ops    << setToValue(tmp, 0)
+                              << movePtr(x)
+                              << "["
+                              <<     decr(x)
+                              <<     incr(tmp)
+                              <<     movePtr(x)
+                              << "]"
+                              << movePtr(y)
+                              << "["
+                              <<     decr(y)
+                              <<     incr(tmp)
+                              <<     movePtr(y)
+                              << "]"
+                              << movePtr(tmp)
+                              << "["
+                              <<     setToValue(tmp, 0)
+                              <<     incr(res)
+                              <<     movePtr(tmp)
+                              << "]";
+                       return ops.str();
+                   });
+}
+
+std::string BFGenerator::bitXor(int const lhs, int const rhs, int const result)
+{
+    return bitwise(lhs, rhs, result,
+                   [this](int const x, int const y, int const res, int const tmp){
+                       std::ostringstream ops;
+                       ops    << movePtr(x)
+                              << "["
+                              <<     decr(x)
+                              <<     incr(res)
+                              <<     movePtr(x)
+                              << "]"
+                              << movePtr(y)
+                              << "["
+                              <<     decr(y)
+                              <<     setToValue(tmp, 1)
+                              <<     movePtr(res)
+                              <<     "["
+                              <<         decr(res)
+                              <<         decr(tmp)
+                              <<         movePtr(res)
+                              <<     "]"
+                              <<     movePtr(tmp)
+                              <<     "["
+                              <<         decr(tmp)
+                              <<         incr(res)
+                              <<         movePtr(tmp)
+                              <<     "]"
+                              <<     movePtr(y)
+                              << "]";
+                       return ops.str();
+                   });
+}
+
+std::string BFGenerator::shiftLeft(int const lhs, int const rhs, int const result)
+{
+    validateAddr(lhs, rhs, result);
+
+    int const tmp = f_getTempBlock(2, near(lhs, rhs, result));
+    int const count = tmp + 0;
+    
+    std::ostringstream ops;
+    ops << assign(result, lhs)
+        << assign(count, rhs)
+        << "["
+        <<     decr(count)
+        <<     twice(result, tmp + 1)
+        <<     movePtr(count)
+        << "]"
+        << movePtr(result);
+
+    return ops.str();
+}
+
+std::string BFGenerator::shiftRight(int const lhs, int const rhs, int const result)
+{
+    validateAddr(lhs, rhs, result);
+
+    int const tmp = f_getTempBlock(4, near(lhs, rhs, result));
+    int const count = tmp + 0;
+    
+    std::ostringstream ops;
+    ops << assign(result, lhs)
+        << assign(count, rhs)
+        << "["
+        <<     decr(count)
+        <<     halve(result, tmp + 1)
+        <<     movePtr(count)
+        << "]"
+        << movePtr(result);
+
+    return ops.str();
+}
+
+std::string BFGenerator::decimalDigits(int const x, int const digits, int const n)
+{
+    // Divides x by 10 n times, storing the remainders in the n digit-cells (most
+    // significant first). Each division counts its operand down once, but every
+    // pass starts from a value ten times smaller than the previous one, so almost
+    // all of the work is done by the first division. That one counts x itself
+    // down into a backup cell, from which it is restored afterwards. The quotients
+    // alternate between the backup cell and the last cell of the block, next to
+    // the remainder and the work cells. Digits that do not fit in n cells are lost.
+
+    validateAddr(x, digits);
+
+    int const tmp = f_getTempBlock(6, near(x));
+    int const backup = tmp + 0;
+    int const rem = tmp + 1;
+    int const work = tmp + 2;   // 3 cells, laid out for divideByTen()
+    int value = tmp + 5;
+    int quot = backup;
+
+    auto const move = [this](int const from, int const to){
+                          std::ostringstream ops;
+                          ops << setToValue(to, 0)
+                              << movePtr(from)
+                              << "["
+                              <<     decr(from)
+                              <<     incr(to)
+                              <<     movePtr(from)
+                              << "]";
+                          return ops.str();
+                      };
+
+    std::ostringstream ops;
+    for (int pos = 0; pos != n; ++pos)
+    {
+        int const digit = digits + n - 1 - pos;
+        if (pos == 0)
+        {
+            ops << divideByTen(x, value, rem, work, backup)
+                << move(backup, x);
+        }
+        else
+        {
+            ops << divideByTen(value, quot, rem, work);
+            std::swap(value, quot);
+        }
+
+        ops << move(rem, digit);
+    }
+
+    ops << setToValue(value, 0);
+    return ops.str();
+}
+
+std::string BFGenerator::printDecimal(int const x)
+{
+    validateAddr(x);
+
+    int const n = std::to_string(d_maxCellValue).size();
+    int const digits = f_getTempBlock(n, near(x));
+
+    std::ostringstream ops;
+    ops << decimalDigits(x, digits, n)
+        << printDigits(digits, n);
+
+    return ops.str();
+}
+
+std::string BFGenerator::printDigits(int const digits, int const n)
+{
+    // Print n decimal digits (most significant first), skipping leading zeros.
+    // The digits are destroyed in the process.
+
+    int const tmp = f_getTempBlock(2, near(digits));
+    int const started = tmp + 0;
+    int const flag = tmp + 1;
+
+    std::ostringstream ops;
+    ops << setToValue(started, 0);
+
+    for (int i = 0; i != n; ++i)
+    {
+        if (i == n - 1)
+            ops << setToValue(started, 1);
+        else
+        {
+            ops << assign(flag, digits + i)
+                << "["
+                <<     setToValue(started, 1)
+                <<     setToValue(flag, 0)
+                << "]";
+        }
+
+        ops << addConst(digits + i, '0')
+            << assign(flag, started)
+            << "["
+            <<     print(digits + i)
+            <<     setToValue(flag, 0)
+            << "]";
+    }
+
+    return ops.str();
+}
+
+std::string BFGenerator::toDecimalString(int const x, int const str, int const n)
+{
+    // The digits are stored left-aligned, followed by zeros. Exactly one of the
+    // digits is the first one to be stored; the branch for this digit copies it
+    // and the digits that follow it.
+    
+    validateAddr(x, str);
+
+    int const digits = f_getTempBlock(n + 3, near(x, str));
+    int const waiting = digits + n;
+    int const flag = digits + n + 1;
+    int const first = digits + n + 2;
+
+    std::ostringstream ops;
+    ops << decimalDigits(x, digits, n)
+        << setToValue(str, 0, n)
+        << setToValue(waiting, 1);
+
+    for (int i = 0; i != n; ++i)
+    {
+        if (i == n - 1)
+            ops << assign(first, waiting);
+        else
+        {
+            ops << setToValue(first, 0)
+                << assign(flag, digits + i)
+                << "["
+                <<     assign(first, waiting)
+                <<     setToValue(flag, 0)
+                << "]";
+        }
+
+        ops << movePtr(first)
+            << "["
+            <<     setToValue(waiting, 0);
+
+        for (int j = 0; i + j != n; ++j)
+        {
+            ops << assign(str + j, digits + i + j)
+                << addConst(str + j, '0');
+        }
+
+        ops <<     setToValue(first, 0)
+            << "]";
+    }
+
+    ops << movePtr(str);
+    return ops.str();
+}
+
+std::string BFGenerator::testNonZero(int const x, int const test, int const nonZero)
+{
+    // nonZero = (x != 0); x is restored through test, which must be zero.
+    std::ostringstream ops;
+    ops << setToValue(nonZero, 0)
+        << movePtr(x)
+        << "["
+        <<     decr(x)
+        <<     incr(test)
+        <<     movePtr(x)
+        << "]"
+        << movePtr(test)
+        << "["
+        <<     "["
+        <<         decr(test)
+        <<         incr(x)
+        <<         movePtr(test)
+        <<     "]"
+        <<     incr(nonZero)
+        <<     movePtr(test)
+        << "]";
+
+    return ops.str();
+}
+
+std::string BFGenerator::stringLength(int const str, int const n, int const result)
+{
+    // Every position is visited at most once: the work for a position is skipped
+    // once the terminating zero has been found.
+    
+    validateAddr(str, result);
+
+    int const tmp = f_getTempBlock(4, near(str, result));
+    int const alive = tmp + 0;
+    int const gate = tmp + 1;
+    int const test = tmp + 2;
+    int const nonZero = tmp + 3;
+
+    std::ostringstream ops;
+    ops << setToValue(result, 0)
+        << setToValue(alive, 1)
+        << setToValue(test, 0);
+
+    for (int i = 0; i != n; ++i)
+    {
+        ops << assign(gate, alive)
+            << movePtr(gate)
+            << "["
+            <<     testNonZero(str + i, test, nonZero)
+            <<     setToValue(alive, 0)
+            <<     movePtr(nonZero)
+            <<     "["
+            <<         decr(nonZero)
+            <<         incr(alive)
+            <<         incr(result)
+            <<         movePtr(nonZero)
+            <<     "]"
+            <<     setToValue(gate, 0)
+            <<     movePtr(gate)
+            << "]";
+    }
+
+    ops << movePtr(result);
+    return ops.str();
+}
+
+std::string BFGenerator::stringCompare(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result)
+{
+    // Positions beyond the end of an array are treated as zero. The comparison stops
+    // at the first difference or at the common terminating zero.
+
+    validateAddr(lhs, rhs, result);
+
+    int const tmp = f_getTempBlock(5, near(lhs, rhs, result));
+    int const alive = tmp + 0;
+    int const gate = tmp + 1;
+    int const test = tmp + 2;
+    int const diff = tmp + 3;
+    int const nonZero = tmp + 4;
+
+    std::ostringstream ops;
+    ops << setToValue(result, 1)
+        << setToValue(alive, 1)
+        << setToValue(test, 0);
+
+    for (int i = 0; i != std::max(nLhs, nRhs); ++i)
+    {
+        ops << assign(gate, alive)
+            << movePtr(gate)
+            << "["
+            <<     setToValue(diff, 0)
+            <<     setToValue(nonZero, 0);
+
+        if (i < nLhs)
+        {
+            ops << movePtr(lhs + i)
+                << "["
+                <<     decr(lhs + i)
+                <<     incr(test)
+                <<     incr(diff)
+                <<     movePtr(lhs + i)
+                << "]"
+                << movePtr(test)
+                << "["
+                <<     "["
+                <<         decr(test)
+                <<         incr(lhs + i)
+                <<         movePtr(test)
+                <<     "]"
+                <<     incr(nonZero)
+                <<     movePtr(test)
+                << "]";
+        }
+
+        if (i < nRhs)
+        {
+            ops << movePtr(rhs + i)
+                << "["
+                <<     decr(rhs + i)
+                <<     incr(test)
+                <<     decr(diff)
+                <<     movePtr(rhs + i)
+                << "]"
+                << movePtr(test)
+                << "["
+                <<     decr(test)
+                <<     incr(rhs + i)
+                <<     movePtr(test)
+                << "]";
+        }
+
+        // Continue only if both characters are equal and not the terminator
+        ops <<     movePtr(diff)
+            <<     "["
+            <<         setToValue(diff, 0)
+            <<         setToValue(result, 0)
+            <<         setToValue(nonZero, 0)
+            <<         movePtr(diff)
+            <<     "]"
+            <<     setToValue(alive, 0)
+            <<     movePtr(nonZero)
+            <<     "["
+            <<         decr(nonZero)
+            <<         incr(alive)
+            <<         movePtr(nonZero)
+            <<     "]"
+            <<     setToValue(gate, 0)
+            <<     movePtr(gate)
+            << "]";
+    }
+
+    ops << movePtr(result);
+    return ops.str();
+}
+
+std::string BFGenerator::stringCopy(int const dest, int const src, int const n, int const result)
+{
+    // Copies the first n positions of src up to (not including) the terminating
+    // zero; result is the number of characters copied.
+
+    validateAddr(dest, src, result);
+
+    int const tmp = f_getTempBlock(4, near(dest, src, result));
+    int const alive = tmp + 0;
+    int const gate = tmp + 1;
+    int const test = tmp + 2;
+    int const nonZero = tmp + 3;
+
+    std::ostringstream ops;
+    ops << setToValue(result, 0)
+        << setToValue(alive, 1)
+        << setToValue(test, 0);
+
+    for (int i = 0; i != n; ++i)
+    {
+        ops << assign(gate, alive)
+            << movePtr(gate)
+            << "["
+            <<     setToValue(nonZero, 0)
+            <<     movePtr(src + i)
+            <<     "["
+            <<         decr(src + i)
+            <<         incr(test)
+            <<         movePtr(src + i)
+            <<     "]"
+            <<     movePtr(test)
+            <<     "["
+            <<         incr(nonZero)
+            <<         setToValue(dest + i, 0)
+            <<         movePtr(test)
+            <<         "["
+            <<             decr(test)
+            <<             incr(src + i)
+            <<             incr(dest + i)
+            <<             movePtr(test)
+            <<         "]"
+            <<     "]"
+            <<     setToValue(alive, 0)
+            <<     movePtr(nonZero)
+            <<     "["
+            <<         decr(nonZero)
+            <<         incr(alive)
+            <<         incr(result)
+            <<         movePtr(nonZero)
+            <<     "]"
+            <<     setToValue(gate, 0)
+            <<     movePtr(gate)
+            << "]";
+    }
+
+    ops << movePtr(result);
+    return ops.str();
+}
+
+std::string BFGenerator::ifZero(int const x, std::function<std::string()> const &body)
+{
+    // Runs body (with the pointer at x + 1) if x is zero, without having to copy x.
+    // This requires x to be followed by two cells holding 1 and 0. The pointer
+    // ends up at x + 2 in both cases, after which x + 1 is restored to 1.
+
+    std::ostringstream ops;
+    ops << movePtr(x)
+        << "[>-]>[";
+
+    d_pointer = x + 1;
+    ops << body()
+        << movePtr(x + 1)
+        << "->]<+";
+
+    d_pointer = x + 1;
+    return ops.str();
+}
+
+std::string BFGenerator::counterSetup(int const counter, int const m)
+{
+    // A counter of m digits occupies 3m cells: each digit is followed by a 1 and a
+    // 0, such that it can be tested for zero in constant time (see ifZero()).
+
+    std::ostringstream ops;
+    ops << setToValue(counter, 0, 3 * m);
+    for (int k = 0; k != m; ++k)
+        ops << setToValue(counter + 3 * k + 1, 1);
+
+    return ops.str();
+}
+
+std::string BFGenerator::counterIncr(int const counter, int const m, int const k)
+{
+    // Increment digit k, carrying into the next digit when it wraps to 0
+
+    std::ostringstream ops;
+    ops << incr(counter + 3 * k);
+    if (k + 1 != m)
+    {
+        ops << ifZero(counter + 3 * k, [=, this](){
+                                           return counterIncr(counter, m, k + 1);
+                                       });
+    }
+
+    return ops.str();
+}
+
+std::string BFGenerator::counterDecr(int const counter, int const m, int const k)
+{
+    // Decrement digit k, borrowing from the next digit when it is 0
+
+    std::ostringstream ops;
+    if (k + 1 != m)
+    {
+        ops << ifZero(counter + 3 * k, [=, this](){
+                                           return counterDecr(counter, m, k + 1);
+                                       });
+    }
+
+    ops << decr(counter + 3 * k);
+    return ops.str();
+}
+
+std::string BFGenerator::counterAdd(int const counter, int const m, int const k, int const x, int const scratch, bool const subtract)
+{
+    // Add (or subtract) the value of x to digit k, one unit at a time. Every unit
+    // takes constant time, apart from the (amortized) carries. The two scratch
+    // cells are used to count and to restore x.
+
+    int const count = scratch + 0;
+    int const back = scratch + 1;
+
+    std::ostringstream ops;
+    ops << setToValue(count, 0)
+        << setToValue(back, 0)
+        << movePtr(x)
+        << "["
+        <<     decr(x)
+        <<     incr(count)
+        <<     incr(back)
+        <<     movePtr(x)
+        << "]"
+        << movePtr(back)
+        << "["
+        <<     decr(back)
+        <<     incr(x)
+        <<     movePtr(back)
+        << "]"
+        << movePtr(count)
+        << "["
+        <<     decr(count)
+        <<     (subtract ? counterDecr(counter, m, k) : counterIncr(counter, m, k))
+        <<     movePtr(count)
+        << "]";
+
+    return ops.str();
+}
+
+std::string BFGenerator::counterLoad(int const counter, int const m, int const x, int const n)
+{
+    std::ostringstream ops;
+    ops << counterSetup(counter, m);
+    for (int k = 0; k != std::min(m, n); ++k)
+        ops << assign(counter + 3 * k, x + k);
+
+    return ops.str();
+}
+
+std::string BFGenerator::counterStore(int const counter, int const n, int const result)
+{
+    // Moves the digits of the counter into the result; the counter is destroyed.
+
+    std::ostringstream ops;
+    for (int k = 0; k != n; ++k)
+    {
+        ops << setToValue(result + k, 0)
+            << movePtr(counter + 3 * k)
+            << "["
+            <<     decr(counter + 3 * k)
+            <<     incr(result + k)
+            <<     movePtr(counter + 3 * k)
+            << "]";
+    }
+
+    ops << movePtr(result);
+    return ops.str();
+}
+
+std::string BFGenerator::bigAdd(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result, bool const subtract)
+{
+    // Multi-cell integers are stored least significant cell first. The result has as
+    // many cells as lhs; digits of rhs beyond that are ignored.
+    
+    validateAddr(lhs, rhs, result);
+
+    int const tmp = f_getTempBlock(3 * nLhs + 2, near(lhs, rhs, result));
+    int const scratch = tmp + 0;
+    int const counter = tmp + 2;
+
+    std::ostringstream ops;
+    ops << counterLoad(counter, nLhs, lhs, nLhs);
+    for (int k = 0; k != std::min(nLhs, nRhs); ++k)
+        ops << counterAdd(counter, nLhs, k, rhs + k, scratch, subtract);
+
+    ops << counterStore(counter, nLhs, result);
+    return ops.str();
+}
+
+std::string BFGenerator::bigMultiply(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result)
+{
+    // Schoolbook multiplication: for every digit i of lhs, the digits of rhs are
+    // added lhs[i] times to the digits of the result, shifted by i. The digits of
+    // rhs are copied next to the result first, to keep the pointer close by.
+
+    validateAddr(lhs, rhs, result);
+
+    int const n = nLhs;
+    int const nLocal = std::min(n, nRhs);
+    int const tmp = f_getTempBlock(3 + nLocal + 3 * n, near(lhs, rhs, result));
+    int const outer = tmp + 0;
+    int const scratch = tmp + 1;
+    int const local = tmp + 3;
+    int const counter = local + nLocal;
+
+    std::ostringstream ops;
+    ops << assign(local, rhs, nLocal)
+        << counterSetup(counter, n);
+
+    for (int i = 0; i != n; ++i)
+    {
+        ops << assign(outer, lhs + i)
+            << "["
+            <<     decr(outer);
+
+        for (int j = 0; i + j < n && j < nLocal; ++j)
+            ops << counterAdd(counter, n, i + j, local + j, scratch, false);
+
+        ops <<     movePtr(outer)
+            << "]";
+    }
+
+    ops << counterStore(counter, n, result);
+    return ops.str();
+}
+
+std::string BFGenerator::bigLess(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result)
+{
+    // lhs - rhs is computed with an extra digit, which only becomes nonzero
+    // when a borrow runs out of the top (lhs < rhs).
+
+    validateAddr(lhs, rhs, result);
+
+    int const m = std::max(nLhs, nRhs) + 1;
+    int const tmp = f_getTempBlock(3 * m + 2, near(lhs, rhs, result));
+    int const scratch = tmp + 0;
+    int const counter = tmp + 2;
+    int const top = counter + 3 * (m - 1);
+    
+    std::ostringstream ops;
+    ops << counterLoad(counter, m, lhs, nLhs);
+    for (int k = 0; k != nRhs; ++k)
+        ops << counterAdd(counter, m, k, rhs + k, scratch, true);
+
+    // The top digit is either 0 or the maximum value
+    ops << setToValue(result, 0)
+        << movePtr(top)
+        << "["
+        <<     setToValue(result, 1)
+        <<     incr(top)
+        <<     movePtr(top)
+        << "]"
+        << movePtr(result);
+
+    return ops.str();
+}
+
+std::string BFGenerator::bigEqual(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result)
+{
+    // lhs and rhs are equal if all digits of lhs - rhs are zero
+
+    validateAddr(lhs, rhs, result);
+
+    int const m = std::max(nLhs, nRhs);
+    int const tmp = f_getTempBlock(3 * m + 2, near(lhs, rhs, result));
+    int const scratch = tmp + 0;
+    int const counter = tmp + 2;
+    
+    std::ostringstream ops;
+    ops << counterLoad(counter, m, lhs, nLhs);
+    for (int k = 0; k != nRhs; ++k)
+        ops << counterAdd(counter, m, k, rhs + k, scratch, true);
+
+    ops << setToValue(result, 1);
+    for (int k = 0; k != m; ++k)
+    {
+        ops << movePtr(counter + 3 * k)
+            << "["
+            <<     setToValue(result, 0)
+            <<     setToValue(counter + 3 * k, 0)
+            << "]";
+    }
+
+    ops << movePtr(result);
+    return ops.str();
+}
+
+std::string BFGenerator::divideByTen(int const x, int const quot, int const rem, int const work, int const backup)
+{
+    // Counts x down to zero (destroying it), while counting quot and rem up. The
+    // work cells count down from 10 to detect when rem wraps; they are laid out
+    // for ifZero(). When a backup cell is passed, x is counted into it as well.
+
+    int const rest = work + 0;
+    
+    std::ostringstream ops;
+    ops << setToValue(quot, 0)
+        << setToValue(rem, 0)
+        << setToValue(rest, 10)
+        << setToValue(work + 1, 1)
+        << setToValue(work + 2, 0);
+
+    if (backup >= 0)
+        ops << setToValue(backup, 0);
+
+    ops << movePtr(x)
+        << "["
+        <<     decr(x)
+        <<     ((backup >= 0) ? incr(backup) : "")
+        <<     incr(rem)
+        <<     decr(rest)
+        <<     ifZero(rest, [=, this](){
+                                std::ostringstream body;
+                                body << addConst(rest, 10)
+                                     << addConst(rem, -10)
+                                     << incr(quot);
+                                return body.str();
+                            })
+        <<     movePtr(x)
+        << "]";
+
+    return ops.str();
+}
+
+std::string BFGenerator::bigPrintDecimal(int const x, int const n)
+{
+    // The decimal digits are found by repeated long division by 10, starting at the
+    // most significant cell. With a cell-range of B = 10K + R, each step divides
+    // r * B + x[i] (r being the remainder of the previous step) as
+    //
+    //     q = r * K + x[i] / 10 + (r * R + x[i] % 10) / 10
+    //     r = (r * R + x[i] % 10) % 10
+    //
+    // such that none of the intermediate values overflow.
+
+    validateAddr(x);
+
+    long const base = d_maxCellValue + 1;
+    int const K = base / 10;
+    int const R = base % 10;
+    int const nDigits = std::floor(n * std::log10((double)base)) + 1;
+
+    int const digits = f_getTempBlock(nDigits, near(x));
+    int const tmp = f_getTempBlock(n + 10, near(x, digits));
+    int const quot = tmp + 0;       // n cells
+    int const rem = tmp + n;
+    int const k = tmp + n + 1;
+    int const back = tmp + n + 2;
+    int const div = tmp + n + 3;
+    int const part = tmp + n + 4;
+    int const count = tmp + n + 5;
+    int const work = tmp + n + 6;   // 3 cells
+    int const scratch = tmp + n + 9;
+
+    auto const move = [this](int const from, int const to){
+                          std::ostringstream ops;
+                          ops << movePtr(from)
+                              << "["
+                              <<     decr(from)
+                              <<     incr(to)
+                              <<     movePtr(from)
+                              << "]";
+                          return ops.str();
+                      };
+    
+    std::ostringstream ops;
+    ops << assign(quot, x, n)
+        << setToValue(k, 0)
+        << setToValue(scratch, 0)
+        << setToValue(back, 0);
+
+    // K may be large: use a loop to initialize it
+    int const root = (K > 16) ? std::sqrt(K) : 1;
+    ops << setToValue(scratch, root)
+        << "["
+        <<     decr(scratch)
+        <<     addConst(k, K / root)
+        <<     movePtr(scratch)
+        << "]"
+        << addConst(k, K % root);
+
+    for (int d = nDigits - 1; d >= 0; --d)
+    {
+        ops << setToValue(rem, 0);
+        for (int i = n - 1; i >= 0; --i)
+        {
+            // part = r * R + x[i] % 10, quot[i] = x[i] / 10 + r * K
+            ops << divideByTen(quot + i, div, part, work)
+                << move(div, quot + i)
+                << setToValue(count, 0)
+                << move(rem, count)
+                << movePtr(count)
+                << "["
+                <<     decr(count)
+                <<     addConst(part, R)
+                <<     movePtr(k)
+                <<     "["
+                <<         decr(k)
+                <<         incr(quot + i)
+                <<         incr(back)
+                <<         movePtr(k)
+                <<     "]"
+                <<     move(back, k)
+                <<     movePtr(count)
+                << "]"
+                << divideByTen(part, div, rem, work)
+                << move(div, quot + i);
+        }
+
+        ops << setToValue(digits + d, 0)
+            << move(rem, digits + d);
+    }
+
+    ops << printDigits(digits, nDigits);
+    return ops.str();
+}
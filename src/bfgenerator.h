@@ -4,16 +4,19 @@
 #include <iostream>
 #include <functional>
 #include <map>
+#include <vector>
 
 class BFGenerator
 {
   size_t                  d_pointer{0};
   size_t                  d_maxCellValue;
-  std::function<int()>    f_getTemp;
-  std::function<int(int)> f_getTempBlock;
-  std::function<int()>    f_getMemSize;
+  std::function<int(int)>      f_getTemp;       // hint
+  std::function<int(int, int)> f_getTempBlock;  // size, hint
+  std::function<int()>         f_getMemSize;
 
   std::map<int, int> d_profile;
+
+  static constexpr size_t MAX_COPY_LANE = 16;
     
 public:
   BFGenerator(size_t maxCellValue = 0xff):
@@ -24,6 +27,11 @@ public:
   {
     return d_pointer;
   }
+
+  void setPointerIndex(size_t const ptr)
+  {
+    d_pointer = ptr;
+  }
     
   template <typename GetTemp>
   void setTempRequestFn(GetTemp &&getTemp)
@@ -46,14 +54,19 @@ public:
   std::string movePtr(int const addr);
   std::string scan(int const addr);
   std::string print(int const addr);
+  std::string printValues(int const scratch, std::vector<int> const &values);
+  std::string printString(int const start, int const n);
   std::string random(int const addr);
-  std::string fetchElement(int const arrStart, int const arrSize, int const index, int const ret);
+  std::string fetchElement(int const arrStart, int const arrSize, int const index, int const ret, int const offset = 0);
   std::string setToValue(int const addr, int const val);
   std::string setToValue(int const start, int const val, size_t const n);
+  std::string setToValues(int const start, std::vector<int> const &values, int const base = 0);
   std::string setToValuePlus(int const addr, int const val);
   std::string setToValuePlus(int const addr, int const val, size_t const n);
   std::string assign(int const lhs, int const rhs);
-  std::string assignElement(int const arrStart, int const arrSize, int const index, int const val);
+  std::string assign(int const lhs, int const rhs, size_t const n);
+  std::string fill(int const start, size_t const n, int const rhs);
+  std::string assignElement(int const arrStart, int const arrSize, int const index, int const val, int const offset = 0);
   std::string addTo(int const target, int const rhs);
   std::string addConst(int const target, int const amount);
   std::string incr(int const target);
@@ -77,6 +90,23 @@ public:
   std::string logicalAnd(int const lhs, int const rhs);
   std::string logicalOr(int const lhs, int const rhs, int const result);
   std::string logicalOr(int const lhs, int const rhs);
+  std::string bitAnd(int const lhs, int const rhs, int const result);
+  std::string bitOr(int const lhs, int const rhs, int const result);
+  std::string bitXor(int const lhs, int const rhs, int const result);
+  std::string shiftLeft(int const lhs, int const rhs, int const result);
+  std::string shiftRight(int const lhs, int const rhs, int const result);
+  std::string printDecimal(int const x);
+  std::string toDecimalString(int const x, int const str, int const n);
+  std::string stringLength(int const str, int const n, int const result);
+  std::string stringCompare(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result);
+  std::string stringCopy(int const dest, int const src, int const n, int const result);
+  std::string bigAdd(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result, bool const subtract = false);
+  std::string bigMultiply(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result);
+  std::string bigLess(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result);
+  std::string bigEqual(int const lhs, int const nLhs, int const rhs, int const nRhs, int const result);
+  std::string bigPrintDecimal(int const x, int const n);
+
+  static int multiplier(int const val, int const base);
 
   inline std::map<int, int> const &profile() const
   {
@@ -84,6 +114,31 @@ public:
   }
     
 private:
+  using BitCombiner = std::function<std::string(int, int, int, int)>; // bit, bit, result, tmp
+    
+  int bits() const;
+  std::string halve(int const x, int const tmp);
+  std::string twice(int const x, int const tmp);
+  std::string bitwise(int const lhs, int const rhs, int const result, BitCombiner const &combine);
+  std::string decimalDigits(int const x, int const digits, int const n);
+  std::string testNonZero(int const x, int const test, int const nonZero);
+  std::string printDigits(int const digits, int const n);
+  std::string ifZero(int const x, std::function<std::string()> const &body);
+  std::string counterSetup(int const counter, int const m);
+  std::string counterIncr(int const counter, int const m, int const k);
+  std::string counterDecr(int const counter, int const m, int const k);
+  std::string counterAdd(int const counter, int const m, int const k, int const x, int const scratch, bool const subtract);
+  std::string counterLoad(int const counter, int const m, int const x, int const n);
+  std::string counterStore(int const counter, int const n, int const result);
+  std::string divideByTen(int const x, int const quot, int const rem, int const work, int const backup = -1);
+
+  template <typename ... Addr>
+  int near(Addr const ... addrs) const
+  {
+    // Temporaries are requested close to the operands they are used with and
+    // to the current position of the pointer.
+    return (d_pointer + ... + addrs) / (1 + sizeof ... (addrs));
+  }
     
   template <typename ... Rest>
   void validateAddr__(std::string const &function, int first, Rest&& ... rest) const
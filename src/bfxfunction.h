@@ -93,6 +93,11 @@ public:
     {
         return std::string("__f_") + std::to_string(nArgs) + "_" + name;
     }
+
+    static std::string demangle(std::string const &mangled)
+    {
+        return mangled.substr(mangled.find('_', 4) + 1);
+    }
 };
 
 #endif 
@@ -20,6 +20,78 @@ namespace _MaxInt
     }
 }
 
+namespace _BigNum
+{
+    // Compiletime arithmetic on multi-cell integers: every cell is a digit in base
+    // (MAX_INT + 1), least significant first.
+    
+    using Digits = std::vector<long>;
+
+    static Digits add(Digits const &lhs, Digits const &rhs, long const base, bool const subtract)
+    {
+        Digits result(lhs.size());
+        long carry = 0;
+        for (size_t i = 0; i != lhs.size(); ++i)
+        {
+            long const r = (i < rhs.size()) ? rhs[i] : 0;
+            long const val = lhs[i] + carry + (subtract ? -r : r);
+            carry = (val < 0) ? -1 : (val >= base) ? 1 : 0;
+            result[i] = val - carry * base;
+        }
+        return result;
+    }
+
+    static Digits multiply(Digits const &lhs, Digits const &rhs, long const base)
+    {
+        // Products of two digits and a carry fit in 64 bits, even for 32-bit cells
+        size_t const n = lhs.size();
+        Digits result(n, 0);
+        for (size_t i = 0; i != n; ++i)
+        {
+            unsigned long long carry = 0;
+            for (size_t j = 0; i + j < n && j < rhs.size(); ++j)
+            {
+                unsigned long long const cur = result[i + j] + carry +
+                    static_cast<unsigned long long>(lhs[i]) * rhs[j];
+                result[i + j] = cur % base;
+                carry = cur / base;
+            }
+        }
+        return result;
+    }
+
+    static int compare(Digits const &lhs, Digits const &rhs)
+    {
+        for (size_t i = std::max(lhs.size(), rhs.size()); i-- != 0; )
+        {
+            long const l = (i < lhs.size()) ? lhs[i] : 0;
+            long const r = (i < rhs.size()) ? rhs[i] : 0;
+            if (l != r)
+                return (l < r) ? -1 : 1;
+        }
+        return 0;
+    }
+
+    static std::string toString(Digits x, long const base)
+    {
+        std::string str;
+        do
+        {
+            unsigned long long rem = 0;
+            for (size_t i = x.size(); i-- != 0; )
+            {
+                unsigned long long const cur = rem * base + x[i];
+                x[i] = cur / 10;
+                rem = cur % 10;
+            }
+            str.insert(str.begin(), '0' + rem);
+        }
+        while (std::any_of(x.begin(), x.end(), [](long d){ return d != 0; }));
+
+        return str;
+    }
+}
+
 Compiler::Compiler(Options const &opt):
     MAX_INT(_MaxInt::get(opt.cellType)),
     MAX_ARRAY_SIZE(MAX_INT - 5),
@@ -29,6 +101,9 @@ Compiler::Compiler(Options const &opt):
     d_scanner(opt.bfxFile, ""),
     d_memory(TAPE_SIZE_INITIAL),
     d_bfGen(MAX_INT),
+    d_dataFlow(MAX_INT, opt.constEvalAllowed),
+    d_partialEval(MAX_INT, opt.partialEvalBudget),
+    d_sourceMap(!opt.sourceMapFile.empty()),
     d_includePaths(opt.includePaths),
     d_constEvalEnabled(opt.constEvalAllowed),
     d_constEvalAllowed(opt.constEvalAllowed),
@@ -36,21 +111,29 @@ Compiler::Compiler(Options const &opt):
     d_bcrEnabled(opt.bcrEnabled),
     d_includeWarningEnabled(opt.includeWarningEnabled),
     d_assertWarningEnabled(opt.assertWarningEnabled),
+    d_memoryReuseEnabled(opt.memoryReuseEnabled),
+    d_deadStoreEliminationEnabled(opt.deadStoreEliminationEnabled),
+    d_deadStoreWarningEnabled(opt.deadStoreWarningEnabled),
+    d_cellLayoutEnabled(opt.cellLayoutEnabled),
+    d_optimizeFor(opt.optimizeFor),
+    d_outlineThreshold(opt.outlineThreshold),
     d_outStream(*opt.outStream),
     d_profileFile(opt.profileFile),
+    d_sourceMapFile(opt.sourceMapFile),
     d_testFile(opt.testFile)
 {
     d_includePaths.push_back(".");
     d_includePaths.push_back(BFX_DEFAULT_INCLUDE_PATH_STRING);
     
     d_included.push_back(fileWithoutPath(opt.bfxFile));
+    d_outlined.insert(opt.outlined.begin(), opt.outlined.end());
     
-    d_bfGen.setTempRequestFn([this](){
-                                 return allocateTemp();
+    d_bfGen.setTempRequestFn([this](int const hint){
+                                 return allocateTemp(1, hint);
                              });
     
-    d_bfGen.setTempBlockRequestFn([this](int const sz){
-                                      return allocateTempBlock(sz);
+    d_bfGen.setTempBlockRequestFn([this](int const sz, int const hint){
+                                      return allocateTempBlock(sz, hint);
                                   });
     
     d_bfGen.setMemSizeRequestFn([this](){
@@ -64,11 +147,23 @@ Compiler::State Compiler::save()
             .memory         = d_memory,
             .scope          = d_scope,
             .bfGen          = d_bfGen,
-            .buffer         = d_codeBuffer.str(),
+            .dataFlow       = d_dataFlow,
+            .liveness       = d_liveness.checkpoint(),
+            .layout         = d_layout.checkpoint(),
+            .dispatch       = d_dispatch,
+            .instances      = d_instances,
+            .buffer         = d_codeBuffer,
+            .sourceMap      = d_sourceMap,
             .constEval      = d_constEvalEnabled,
             .loopUnrolling  = d_loopUnrolling,
+            .loopDepth      = d_loopDepth,
+            .unrollReport   = d_unrollReport,
             .boundsChecking = d_boundsCheckingEnabled,
             .bcrMap         = d_bcrMap,
+            .clearedFlags   = d_clearedFlags,
+            .values         = d_values,
+            .deadStores     = d_deadStores,
+            .deadStoreCount = d_deadStoreCount,
     };
 }
 
@@ -77,12 +172,23 @@ void Compiler::restore(State &&state)
     d_memory                       = std::move(state.memory);
     d_scope                        = std::move(state.scope);
     d_bfGen                        = std::move(state.bfGen);
+    d_dataFlow                     = std::move(state.dataFlow);
+    d_liveness.rollback(state.liveness);
+    d_layout.rollback(state.layout);
+    d_dispatch                     = std::move(state.dispatch);
+    d_instances                    = std::move(state.instances);
     d_bcrMap                       = std::move(state.bcrMap);
+    d_clearedFlags                 = std::move(state.clearedFlags);
+    d_values                       = std::move(state.values);
+    d_deadStores                   = std::move(state.deadStores);
+    d_deadStoreCount               = state.deadStoreCount;
     d_constEvalEnabled             = state.constEval;
     d_loopUnrolling                = state.loopUnrolling;
+    d_loopDepth                    = state.loopDepth;
+    d_unrollReport                 = std::move(state.unrollReport);
     d_boundsCheckingEnabled        = state.boundsChecking;
-    d_codeBuffer.str(state.buffer);
-    d_codeBuffer.seekp(0, std::ios_base::end);
+    d_codeBuffer                   = std::move(state.buffer);
+    d_sourceMap                    = std::move(state.sourceMap);
 }
 
 void Compiler::disableBoundChecking()
@@ -177,8 +283,19 @@ bool Compiler::setConstEval(bool const enable)
 
         // Sync all variables that are currently in scope.
         std::vector<int> scopeCells = d_memory.cellsInScope(d_scope.current());
-        for (int const addr: scopeCells)
-            sync(addr);
+        std::sort(scopeCells.begin(), scopeCells.end());
+        scopeCells.erase(std::unique(scopeCells.begin(), scopeCells.end()), scopeCells.end());
+
+        size_t i = 0;
+        while (i != scopeCells.size())
+        {
+            int n = 1;
+            while (i + n != scopeCells.size() && scopeCells[i + n] == scopeCells[i] + n)
+                ++n;
+
+            sync(scopeCells[i], n);
+            i += n;
+        }
 
         d_constEvalEnabled = false;
     }
@@ -200,7 +317,8 @@ int Compiler::compile()
 {
     assert(d_stage == Stage::IDLE && "Calling Compiler::compile() multiple times");
     assert(d_bfGen.getPointerIndex() == 0 && "Pointer should be at 0");
-    
+
+    auto const start = std::chrono::steady_clock::now();
     d_stage = Stage::PARSING;
     int err = parse();
     if (err)
@@ -214,15 +332,163 @@ int Compiler::compile()
 
     addConstant("__MAX_LOOP_UNROLL_ITERATIONS", MAX_LOOP_UNROLL_ITERATIONS);
     d_stage = Stage::CODEGEN;
-    instruction<&Compiler::call>("main", std::vector<Instruction>{})();
+    generate();
+
+    size_t const generated = d_codeBuffer.size();
+    d_codeBuffer = d_partialEval.process(d_codeBuffer);
+    if (d_partialEval.steps() > 0)
+    {
+        size_t const resumed = d_partialEval.resumed();
+        d_sourceMap.replacePrefix(resumed, d_codeBuffer.size() - (generated - resumed),
+                                  {d_sourceFile, 0, "(partial-eval)"});
+    }
     d_stage = Stage::FINISHED;
+    d_compileTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
+    warnDeadStores();
     writeProfile();
     writeTestList();
     
     return 0;
 }
 
+void Compiler::generate()
+{
+    // The first pass records the live range of each variable and how often each
+    // of them is accessed. Depending on the options, the code is then generated
+    // again: first releasing variables right after their last use so their cells
+    // can be reused and leaving out stores that are never read, then with the
+    // variables placed according to the recorded accesses. The result of a pass
+    // is only kept when it is an improvement.
+    
+    State const initial = save();
+    if (d_outlineThreshold > 0)
+        selectOutlined(initial);
+    else
+        generatePass(initial);
+
+    d_unrollReplay = true;
+    d_cellsWithoutReuse = d_memory.cellsRequired();
+
+    Liveness const recorded = d_liveness;
+    Layout layout = std::move(d_layout);
+    
+    auto const attempt = [&](Liveness const *liveness, auto &&improved) -> bool
+                         {
+                             State previous = save();
+                             bool const success = generatePass(initial, liveness) && improved();
+                             if (success)
+                                 return true;
+                             
+                             d_liveness = Liveness{};
+                             restore(std::move(previous));
+                             return false;
+                         };
+
+    d_warningsMuted = true;
+    bool reused = false;
+    if (d_memoryReuseEnabled || d_deadStoreEliminationEnabled)
+    {
+        // The pointer moves of the pass that is kept are used to optimize the layout
+        d_layout = Layout{};
+        reused = attempt(&recorded, [&, cells = d_memory.cellsRequired(), size = d_codeBuffer.size()](){
+                                        return d_memory.cellsRequired() < cells ||
+                                            (d_memory.cellsRequired() == cells && d_codeBuffer.size() < size);
+                                    });
+        if (reused)
+            layout = std::move(d_layout);
+    }
+
+    if (d_cellLayoutEnabled && layout.optimize(d_memory.cellsRequired()))
+    {
+        long const travel = layout.travel();
+        d_layout = std::move(layout);
+        bool const relocated = attempt(reused ? &recorded : nullptr,
+                                       [&, size = d_codeBuffer.size()](){
+                                           return d_layout.travel() < travel && d_codeBuffer.size() <= size;
+                                       });
+        d_cellsRelocated = relocated ? d_layout.relocated() : 0;
+    }
+    
+    d_warningsMuted = false;
+}
+
+void Compiler::selectOutlined(State const &initial)
+{
+    // Functions are called out-of-line when each of their inlined expansions
+    // generates at least the threshold number of operations. This only pays off
+    // when they are called more than once, and only if the program gets smaller.
+    
+    std::set<std::string> const requested = d_outlined;
+    d_warningsMuted = true;
+    d_expansions.clear();
+    generatePass(initial);
+
+    size_t const inlined = d_codeBuffer.size();
+    for (auto const &[name, expansion]: d_expansions)
+    {
+        if (name != "main" && expansion.count > 1 &&
+            expansion.smallest >= static_cast<size_t>(d_outlineThreshold))
+            d_outlined.insert(name);
+    }
+
+    if (d_outlined != requested)
+    {
+        generatePass(initial);
+        if (d_codeBuffer.size() >= inlined)
+            d_outlined = requested;
+    }
+    
+    d_warningsMuted = false;
+    generatePass(initial);
+}
+
+bool Compiler::generatePass(State const &initial, Liveness const *liveness)
+{
+    d_liveness = Liveness{};
+    restore(State{initial});
+    d_liveness = Liveness{};
+    if (liveness)
+    {
+        d_liveness = *liveness;
+        d_liveness.apply(d_memoryReuseEnabled);
+    }
+
+    d_dispatch.enable(!d_outlined.empty());
+    d_unrollDecision = 0;
+    if (!d_unrollReplay)
+        d_unrollDecisions.clear();
+
+    d_memo.clear();
+    d_memoHits = 0;
+    d_valuesReused = 0;
+    d_deadStores.clear();
+    d_deadStoreCount = 0;
+    
+    try
+    {
+        allocateGlobals();
+        instruction<&Compiler::call>("main", std::vector<Instruction>{})();
+    }
+    catch (Liveness::Divergence const &)
+    {
+        // This pass took a different path than the first one
+        return false;
+    }
+
+    if (d_dispatch.enabled())
+    {
+        // Place the routines of the functions that were called out-of-line and
+        // the main program in the dispatch loop.
+        int cells = 0;
+        int const base = d_memory.cellsRequired();
+        d_codeBuffer = d_dispatch.assemble(d_codeBuffer, d_bfGen.getPointerIndex(), base, cells);
+        d_memory.reserve(base, base + cells, "__dispatch");
+    }
+
+    return !d_liveness.applying() || d_liveness.complete();
+}
+
 void Compiler::writeProfile() const
 {
     assert(d_stage == Stage::FINISHED && "call writeMemoryProfile after compiling.");
@@ -236,7 +502,7 @@ void Compiler::writeProfile() const
     auto maxLoops = [&]() -> int {
       int count = 0;
       int countMax = 0;
-      for (char c: d_codeBuffer.str()) {
+      for (char c: d_codeBuffer) {
 	if (c == '[') {
 	  if (++count > countMax)
 	    countMax = count;
@@ -248,18 +514,50 @@ void Compiler::writeProfile() const
       return countMax;
     };
     
+    rusage usage;
+    long const maxRss = (getrusage(RUSAGE_SELF, &usage) == 0) ? usage.ru_maxrss : 0; // kB
+
+    std::string outlined = d_outlined.empty() ? "none" : "";
+    for (std::string const &name: d_outlined)
+        outlined += (outlined.empty() ? "" : ", ") + name;
+    
     file << "Profile for " << d_sourceFile << ":\n"
          << "    cell-type:        " << d_cellType << '\n'
          << "    optimization:     " << (d_constEvalEnabled ? "O1" : "O0") << '\n'
          << "    bcr:              " << (d_bcrEnabled ? "enabled" : "disabled") << '\n'
          << "    max unroll:       " << MAX_LOOP_UNROLL_ITERATIONS << '\n'
+         << "    optimize for:     " << d_optimizeFor << '\n'
+         << "    memory reuse:     " << (d_memoryReuseEnabled ? "enabled" : "disabled") << '\n'
+         << "    dead stores:      " << (d_deadStoreEliminationEnabled ? "eliminated" : "kept") << '\n'
+         << "    cell layout:      " << (d_cellLayoutEnabled ? "enabled" : "disabled") << '\n'
+         << "    out-of-line:      " << outlined << '\n'
          << "    random extension: " << (d_randomExtensionEnabled ? "enabled" : "disabled") << '\n'
+         << "    partial eval:     " << (d_partialEval.budget() > 0 ? std::to_string(d_partialEval.budget()) + " steps" : "disabled") << '\n'
          << '\n'
-         << "Number of BF operations generated: " << d_codeBuffer.str().size() << '\n'
-         << "Number of cells required:          " << d_memory.cellsRequired() << '\n'
+         << "Number of BF operations generated: " << d_codeBuffer.size() << '\n'
+         << "Number of cells required:          " << d_memory.cellsRequired()
+         << " (without reuse: " << d_cellsWithoutReuse << ")\n"
+         << "Number of cells relocated:         " << d_cellsRelocated << '\n'
+         << "Number of out-of-line instances:   " << d_instances.size() << '\n'
+         << "Number of memoized calls:          " << d_memoHits << " (" << d_memo.size() << " distinct)\n"
+         << "Number of reused values:           " << d_valuesReused << '\n'
+         << "Number of stores eliminated:       " << d_deadStoreCount << '\n'
+         << "Number of steps evaluated:         " << d_partialEval.steps() << '\n'
 	 << "Maximum number of nested loops:    " << maxLoops() << '\n'
-         << '\n'
-         << "+---------+---------+\n"
+         << "Compilation time:                  " << std::fixed << std::setprecision(3)
+         << d_compileTime << " s\n"
+         << "Peak memory usage:                 " << maxRss << " kB\n"
+         << '\n';
+
+    if (!d_unrollReport.empty())
+    {
+        file << "Loop unrolling (number of instances between brackets):\n";
+        for (auto const &[entry, count]: d_unrollReport)
+            file << "    " << entry << " (" << count << ")\n";
+        file << '\n';
+    }
+
+    file << "+---------+---------+\n"
          << "| address | #visits |\n"
          << "+---------+---------+\n";
     
@@ -267,9 +565,43 @@ void Compiler::writeProfile() const
         file << pr.first << ": " << pr.second << '\n';
 }
 
+void Compiler::warnDeadStores() const
+{
+    if (!d_deadStoreWarningEnabled)
+        return;
+
+    for (auto const &[location, idents]: d_deadStores)
+    {
+        std::cerr << "Warning: in " << location.first << " on line " << location.second
+                  << ": value stored to ";
+        for (auto it = idents.begin(); it != idents.end(); ++it)
+            std::cerr << (it == idents.begin() ? "" : ", ") << '\"' << *it << '\"';
+        std::cerr << " is never read; store eliminated.\n";
+    }
+}
+
 void Compiler::write()
 {
-    d_outStream << cancelOppositeCommands(d_codeBuffer.str()) << '\n';
+    std::vector<size_t> origin;
+    d_outStream << cancelOppositeCommands(d_codeBuffer, d_sourceMap.enabled() ? &origin : nullptr) << '\n';
+    writeSourceMap(origin);
+}
+
+void Compiler::writeSourceMap(std::vector<size_t> const &origin) const
+{
+    if (d_sourceMapFile.empty())
+        return;
+
+    if (d_dispatch.enabled())
+    {
+        // The routines of out-of-line functions are rearranged after generating them
+        std::cerr << "Warning: no source map is written for programs containing out-of-line calls.\n";
+        return;
+    }
+    
+    std::ofstream file(d_sourceMapFile);
+    compilerErrorIf(!file, "Could not open file for source map: ", d_sourceMapFile, ".");
+    d_sourceMap.write(file, origin);
 }
 
 void Compiler::addTest(std::string const &testName,
@@ -396,7 +728,16 @@ void Compiler::addGlobals(std::vector<std::pair<std::string, TypeSystem::Type>>
     {
         auto const &[ident, type] = var;
         compilerErrorIf(type.size() <= 0, "Global declaration of \"", ident, "\" has invalid size specification.");
-        d_memory.allocate(ident, "", type);
+        d_globals.push_back(var);
+    }
+}
+
+void Compiler::allocateGlobals()
+{
+    for (auto const &[ident, type]: d_globals)
+    {
+        int const addr = d_memory.allocate(ident, "", type, d_layout.start(ident, ""));
+        d_layout.declare(ident, "", addr, type.size());
     }
 }
 
@@ -423,7 +764,8 @@ bool Compiler::isCompileTimeConstant(std::string const &ident) const
 
 int Compiler::allocate(std::string const &ident, TypeSystem::Type type)
 {
-    int const addr = d_memory.allocate(ident, d_scope.current(), type);
+    int const addr = d_memory.allocate(ident, d_scope.current(), type,
+                                       d_layout.start(ident, d_scope.current()));
 
     if (!d_loopUnrolling)
     {
@@ -431,9 +773,20 @@ int Compiler::allocate(std::string const &ident, TypeSystem::Type type)
     }
     else if (addr < 0)
     {
-        return d_memory.find(ident, d_scope.current());
+        // Redeclaration during loop unrolling: same variable
+        int const existing = d_memory.find(ident, d_scope.current());
+        d_liveness.use(existing);
+        return existing;
     }
 
+    // Internal variables (like the bcr-flags) are accessed by address rather than
+    // by name, so they can't be tracked by the liveness analysis.
+    if (ident.rfind("__", 0) != 0)
+    {
+        d_liveness.declare(ident, d_scope.current(), addr, type.size());
+        d_layout.declare(ident, d_scope.current(), addr, type.size());
+    }
+    
     return addr;
 }
 
@@ -441,6 +794,7 @@ int Compiler::addressOf(std::string const &ident)
 {
     int addr = d_memory.find(ident, d_scope.current());
     addr = (addr != -1) ? addr : d_memory.find(ident, "");
+    d_liveness.use(addr);
     compilerErrorIf(addr < 0, "Variable \"", ident, "\" not declared in this scope.");
     return addr;
 }
@@ -450,19 +804,20 @@ int Compiler::allocateTemp(TypeSystem::Type type)
     return d_memory.getTemp(d_scope.function(), type);
 }
 
-int Compiler::allocateTemp(int const sz)
+int Compiler::allocateTemp(int const sz, int const hint)
 {
-    return d_memory.getTemp(d_scope.function(), sz);
+    return d_memory.getTemp(d_scope.function(), sz, hint);
 }
 
-int Compiler::allocateTempBlock(int const sz)
+int Compiler::allocateTempBlock(int const sz, int const hint)
 {
-    return d_memory.getTempBlock(d_scope.function(), sz);
+    return d_memory.getTempBlock(d_scope.function(), sz, hint);
 }
 
 int Compiler::sizeOfOperator(std::string const &ident)
 {
     int const sz = d_memory.sizeOf(ident, d_scope.current());
+    d_liveness.use(d_memory.find(ident, d_scope.current()));
     compilerErrorIf(sz == 0, "Variable \"", ident ,"\" not declared in this scope.");
 
     return constVal(sz);
@@ -481,7 +836,7 @@ int Compiler::staticAssert(Instruction const &check, std::string const &msg)
     
     State state = save();
     int const result = check();
-    compilerErrorIf(!d_memory.valueKnown(result),
+    compilerErrorIf(!valueKnown(result),
                     "Could not evaluate static_assert at compiletime.");
 
     compilerErrorIf(!d_memory.value(result), msg);
@@ -491,12 +846,24 @@ int Compiler::staticAssert(Instruction const &check, std::string const &msg)
 
 int Compiler::statement(Instruction const &instr)
 {
-    if (d_bcrEnabled)
+    d_liveness.beginStatement();
+    forgetValues();
+    
+    // A statement only has to be guarded by the flags that may have been cleared
+    // by a break, continue or return that was generated before it. Statements that
+    // precede these in the body of a loop or function, are never skipped. 
+    int const continueFlag = d_bcrEnabled ? getCurrentContinueFlag() : -1;
+    int const breakFlag = d_bcrEnabled ? getCurrentBreakFlag() : -1;
+    bool const checkContinue = d_clearedFlags.find(continueFlag) != d_clearedFlags.end();
+    bool const checkBreak = d_clearedFlags.find(breakFlag) != d_clearedFlags.end();
+    
+    if (checkContinue || checkBreak)
     {
-        int const continueFlag = getCurrentContinueFlag();
-        int const breakFlag = getCurrentBreakFlag();
-
-        Instruction const condition = [&, this](){ return logicalAnd(continueFlag, breakFlag); };
+        Instruction const condition = [&, this](){
+                                          return (checkContinue && checkBreak) ?
+                                              logicalAnd(continueFlag, breakFlag) :
+                                              (checkBreak ? breakFlag : continueFlag);
+                                      };
         Instruction const elseBody = [](){ return -1; };
         ifStatement(condition, instr, elseBody, false);
     }
@@ -505,12 +872,62 @@ int Compiler::statement(Instruction const &instr)
         instr();
     }
     
+    forgetValues();
     d_memory.freeTemps(d_scope.current());
+
+    // Release variables that are not used anymore
+    for (auto const &var: d_liveness.endStatement())
+    {
+        if (d_memory.identifier(var.addr) == var.ident && d_memory.scope(var.addr) == var.scope)
+        {
+            d_memory.free(var.addr);
+            d_layout.release(var.ident, var.scope);
+        }
+    }
+    
     return -1;
 }
 
+std::map<std::string, std::pair<size_t, Compiler::Intrinsic>> const &Compiler::intrinsics()
+{
+    // Functions that are implemented by the compiler: name -> {#arguments, implementation}
+    static std::map<std::string, std::pair<size_t, Intrinsic>> const table{
+        {"__prints", {1, &Compiler::printString}},
+        {"__and",    {2, &Compiler::bitAnd}},
+        {"__or",     {2, &Compiler::bitOr}},
+        {"__xor",    {2, &Compiler::bitXor}},
+        {"__shl",    {2, &Compiler::shiftLeft}},
+        {"__shr",    {2, &Compiler::shiftRight}},
+        {"__printd",    {1, &Compiler::printDecimal}},
+        {"__to_string", {2, &Compiler::toDecimalString}},
+        {"__strlen",    {1, &Compiler::stringLength}},
+        {"__strcmp",    {2, &Compiler::stringCompare}},
+        {"__strcpy",    {2, &Compiler::stringCopy}},
+        {"__memset",    {2, &Compiler::memorySet}},
+        {"__memcpy",    {2, &Compiler::memoryCopy}},
+        {"__big",        {2, &Compiler::bigFromInt}},
+        {"__big_add",    {2, &Compiler::bigAdd}},
+        {"__big_sub",    {2, &Compiler::bigSubtract}},
+        {"__big_mul",    {2, &Compiler::bigMultiply}},
+        {"__big_less",   {2, &Compiler::bigLess}},
+        {"__big_equal",  {2, &Compiler::bigEqual}},
+        {"__big_printd", {1, &Compiler::bigPrintDecimal}}
+    };
+
+    return table;
+}
+
 int Compiler::call(std::string const &name, std::vector<Instruction> const &args)
 {
+    auto const intrinsic = intrinsics().find(name);
+    if (intrinsic != intrinsics().end())
+    {
+        auto const &[nArgs, impl] = intrinsic->second;
+        compilerErrorIf(args.size() != nArgs,
+                        "Intrinsic \"", name, "\" expects ", nArgs, " arguments, got ", args.size(), ".");
+        return (this->*impl)(args);
+    }
+    
     // Check if the function exists
     std::string const mangled = BFXFunction::mangle(name, args.size());
 
@@ -523,7 +940,18 @@ int Compiler::call(std::string const &name, std::vector<Instruction> const &args
     BFXFunction const &func = d_functionMap.at(mangled);
     auto const &params = func.params();
 
+    // Stores before the call might be read by the function and vice versa
+    d_liveness.boundary();
+    if (name != "main" && d_outlined.find(name) != d_outlined.end())
+    {
+        int const ret = callOutOfLine(func, args);
+        d_liveness.boundary();
+        forgetValues();
+        return ret;
+    }
+
     bool returnVariableIsReferenceParameter = false;
+    std::vector<int> inputs;
     for (size_t idx = 0; idx != args.size(); ++idx)
     {
         // Evaluate argument that's passed in and get its size
@@ -534,12 +962,26 @@ int Compiler::call(std::string const &name, std::vector<Instruction> const &args
 
         // Check if the parameter is passed by value or reference
         auto const &[paramIdent, paramType] = params[idx]; 
-        if (paramType == BFXFunction::ParameterType::Value)
+        if (paramType == BFXFunction::ParameterType::Value &&
+            d_memory.isTemp(argAddr) && d_memory.scope(argAddr) == d_scope.function())
+        {
+            // The argument is a temporary that would be freed after this statement
+            // anyway, so it can be moved into the function rather than copied.
+            d_memory.rename(argAddr, paramIdent, func.mangled());
+            d_liveness.declare(paramIdent, func.mangled(), argAddr, d_memory.sizeOf(argAddr));
+            inputs.push_back(argAddr);
+        }
+        else if (paramType == BFXFunction::ParameterType::Value)
         {
             // Allocate local variable for the function of the correct size
             // and copy argument to this location
-            int const paramAddr = d_memory.allocate(paramIdent, func.mangled(), d_memory.type(argAddr));
+            TypeSystem::Type const type = d_memory.type(argAddr);
+            int const paramAddr = d_memory.allocate(paramIdent, func.mangled(), type,
+                                                    d_layout.start(paramIdent, func.mangled()));
+            d_liveness.declare(paramIdent, func.mangled(), paramAddr, type.size());
+            d_layout.declare(paramIdent, func.mangled(), paramAddr, type.size());
             assign(paramAddr, argAddr);
+            inputs.push_back(paramAddr);
         }
         else // Reference
         {
@@ -547,21 +989,52 @@ int Compiler::call(std::string const &name, std::vector<Instruction> const &args
                 returnVariableIsReferenceParameter = true;
                 
             d_memory.addAlias(argAddr, paramIdent, func.mangled());
+            d_liveness.pin(argAddr);
+            inputs.push_back(argAddr);
         }
     }
 
-    // Execute body of the function
-    enterScope(func.mangled());
-    func.body()();
-    exitScope(func.mangled());
+    // When all inputs of the call are known, it might have been evaluated before.
+    // A reference to an empty cell (e.g. an element indexed past the end of its
+    // array) has no size, so such calls are never memoized.
+    bool const memoizable = std::none_of(inputs.begin(), inputs.end(), [this](int const addr){
+                                             return d_memory.isEmpty(addr);
+                                         });
+    std::string const key = memoizable ? memoKey(func, inputs) : "";
+    auto const memo = key.empty() ? d_memo.end() : d_memo.find(key);
+    size_t const size = d_codeBuffer.size();
+    size_t const pointer = d_bfGen.getPointerIndex();
+    bool const returns = !(func.isVoid() || returnVariableIsReferenceParameter);
+    
+    int ret = -1;
+    if (memo != d_memo.end())
+    {
+        ret = replay(memo->second, func, inputs);
+    }
+    else
+    {
+        // Execute body of the function. Code generated after the call belongs
+        // to the statement containing the call again.
+        std::string const file = d_instructionFilename;
+        int const line = d_instructionLineNr;
+        enterScope(func.mangled());
+        func.body()();
+        exitScope(func.mangled());
+        setFilename(file);
+        setLineNr(line);
+    }
+
+    Expansion &expansion = d_expansions[func.name()];
+    size_t const expanded = d_codeBuffer.size() - size;
+    expansion.smallest = (expansion.count++ == 0) ? expanded : std::min(expansion.smallest, expanded);
 
     // Move return variable to local scope before cleaning up (if non-void)
-    int ret = -1;
-    if (!(func.isVoid() || returnVariableIsReferenceParameter))
+    if (returns && memo == d_memo.end())
     {
         // Locate the address of the return-variable
         std::string retVar = func.returnVariable();
         ret = d_memory.find(retVar, func.mangled());
+        d_liveness.use(ret);
         compilerErrorIf(ret == -1,
                 "Returnvalue \"", retVar, "\" of function \"", func.name(),
                 "\" seems not to have been declared in the main scope of the function-body.");
@@ -569,124 +1042,432 @@ int Compiler::call(std::string const &name, std::vector<Instruction> const &args
         // Pull the variable into local (sub)scope as a temp
         d_memory.rename(ret, "", d_scope.current());
         d_memory.markAsTemp(ret);
+        d_liveness.release(ret);
     }
 
-    // Clean up and return
+    // A call that did not generate any code, only changed the values of its
+    // reference parameters, the globals and the return value.
+    if (!key.empty() && memo == d_memo.end() &&
+        d_codeBuffer.size() == size && d_bfGen.getPointerIndex() == pointer)
+        memoize(key, func, inputs, ret);
+
+    // Clean up and return. The function may have changed its reference parameters
+    // and the globals.
     d_memory.freeLocals(func.mangled());
+    d_liveness.release(func.mangled());
+    d_layout.release(func.mangled());
+    d_liveness.boundary();
+    forgetValues();
     return ret;
 }
 
-int Compiler::constVal(int const num)
+std::vector<int> Compiler::globalCells()
 {
-    compilerWarningIf(num > MAX_INT, "use of value ", num, " exceeds limit of ", MAX_INT, ".");
-    
-    int const tmp = allocateTemp();
-    constEvalSetToValue(tmp, num);
-
-    if (!d_constEvalEnabled)
-        runtimeSetToValue(tmp, num);
+    std::vector<int> cells;
+    for (auto const &[ident, type]: d_globals)
+    {
+        int const addr = d_memory.find(ident, "");
+        for (int i = 0; i != type.size(); ++i)
+            cells.push_back(addr + i);
+    }
 
-    return tmp;
+    return cells;
 }
 
-int Compiler::declareVariable(std::string const &ident, TypeSystem::Type type)
+std::string Compiler::memoKey(BFXFunction const &func, std::vector<int> const &inputs)
 {
-    compilerErrorIf(type.isNullType(), "Alias-variable ", ident, " cannot be declared without being initialized." );
-    compilerErrorIf(!type.defined(), "Variable \'", ident, "\' declared with unknown type.");
+    // The key consists of the function and the values of all cells it can read:
+    // its parameters and the globals. Empty when any of these is unknown.
+
+    if (!d_constEvalEnabled)
+        return "";
     
-    int const sz = type.size();
-    compilerErrorIf(sz == 0, "Cannot declare variable \"", ident, "\" of size 0.");
-    compilerErrorIf(sz < 0,
-            "Size must be specified in declaration without initialization of variable ", ident);
+    std::ostringstream key;
+    key << func.mangled();
+    for (int const addr: inputs)
+    {
+        key << ':' << d_memory.type(addr).name();
+        for (int i = 0; i != d_memory.sizeOf(addr); ++i)
+        {
+            if (!valueKnown(addr + i))
+                return "";
+            key << ',' << d_memory.value(addr + i);
+        }
+    }
 
-    compilerErrorIf(type.isIntType() && sz > MAX_ARRAY_SIZE,
-                "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+    key << '|';
+    for (int const addr: globalCells())
+    {
+        if (!valueKnown(addr))
+            return "";
+        key << d_memory.value(addr) << ',';
+    }
 
-    return allocate(ident, type);
+    return key.str();
 }
 
-int Compiler::initializeExpression(std::string const &ident, TypeSystem::Type type, AddressOrInstruction const &rhs)
+void Compiler::memoize(std::string const &key, BFXFunction const &func, std::vector<int> const &inputs, int const ret)
 {
-    // Check validity of arguments:
-    // 1. Size must not equal 0. -1 is okay; this signals that the size has to be deduced.
-    // 2. If it's an intType, its size cannot exceed the MAX_ARRAY_SIZE.
-    // 3. The type needs te be previously defined, in case of user-defined struct-type.
-    
-    int const sz = type.size();
-    compilerErrorIf(sz == 0, "Cannot declare variable \"", ident, "\" of size 0.");
-    compilerErrorIf(type.isIntType() && sz > MAX_ARRAY_SIZE,
-                    "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
-    compilerErrorIf(!type.defined(), "Variable \'", ident, "\' declared with unknown type.");
+    Memo memo;
+    auto const known = [&, this](int const addr, std::vector<int> &values){
+                           if (!valueKnown(addr))
+                               return false;
+                           values.push_back(d_memory.value(addr));
+                           return true;
+                       };
 
-    // If we're not unrolling a loop, we check if the declared variable does not
-    // already exist in the current scope. Enclosing scopes are allowed to have
-    // a variable of the same name (which will be shadowed by the current one).
-    // When unrolling a loop, this check will not be performed because the same
-    // statement will be executed multiple times.
+    auto const &params = func.params();
+    for (size_t idx = 0; idx != inputs.size(); ++idx)
+    {
+        if (params[idx].second != BFXFunction::ParameterType::Reference)
+            continue;
+        
+        for (int i = 0; i != d_memory.sizeOf(inputs[idx]); ++i)
+        {
+            if (!known(inputs[idx] + i, memo.refs))
+                return;
+        }
+    }
 
-    if (!d_loopUnrolling)
+    for (int const addr: globalCells())
     {
-        compilerErrorIf(d_memory.find(ident, d_scope.current(), false) != -1,
-                        "Variable ", ident, " previously declared.");
+        if (!known(addr, memo.globals))
+            return;
     }
 
-    if (type.isNullType())
+    if (ret != -1)
     {
-        // Variable was declared without a type, which means it's an alias variable
-        // and no new memory needs to be allocated.
-        compilerErrorIf(rhs < 0, "Use of void expression in assignment.");
-        compilerErrorIf(d_memory.isTemp(rhs), "Cannot create alias to temporary value.");
-        if (!d_loopUnrolling)
-            d_memory.addAlias(rhs, ident, d_scope.current());
-        return rhs;
+        memo.retType = d_memory.type(ret);
+        for (int i = 0; i != memo.retType.size(); ++i)
+        {
+            if (!known(ret + i, memo.ret))
+                return;
+        }
     }
 
-    // If we arrive at this point, a new variable has been declared which needs to
-    // be initialized with the result of the evaluation of rhs, which cannot be void.
-    compilerErrorIf(rhs < 0, "Use of void expression in assignment.");
+    d_memo.insert({key, std::move(memo)});
+}
 
-    // A small optimization can be performed when the rhs cell contains a temporary:
-    // the temp can simply be renamed to avoid the copy. This only works when not in
-    // the middle of loop-unrolling.
+int Compiler::replay(Memo const &memo, BFXFunction const &func, std::vector<int> const &inputs)
+{
+    ++d_memoHits;
     
-    TypeSystem::Type rhsType = d_memory.type(rhs);
-    if (d_memory.isTemp(rhs) && (sz == -1 || type == rhsType) && !d_loopUnrolling)
+    auto const &params = func.params();
+    size_t value = 0;
+    for (size_t idx = 0; idx != inputs.size(); ++idx)
     {
-        // In this situation, we can simply rename the temporary variable that resulted
-        // from evaluating rhs to the declared variable.
+        if (params[idx].second != BFXFunction::ParameterType::Reference)
+            continue;
         
-        d_memory.rename(rhs, ident, d_scope.current());
-        return rhs;
-    }
-    else if (type == rhsType || (type.isIntType() && rhsType.isIntType()))
-    {
-        // rhs is not a temp, so we need to copy the result into a newly allocated
-        // variable.
-        return assign(allocate(ident, (sz != -1) ? type : rhsType), rhs);
+        for (int i = 0; i != d_memory.sizeOf(inputs[idx]); ++i)
+            constEvalSetToValue(inputs[idx] + i, memo.refs[value++]);
     }
 
-    // If none of the cases matched, this means there's a type-mismatch between the
-    // lhs and rhs of the assignment.
-    compilerError("Type mismatch in assignment of \"", rhsType.name(),
-                  "\" to variable \"", ident, "\" of type \"", type.name(), "\"." );
-    return -1;
-}
+    std::vector<int> const globals = globalCells();
+    for (size_t idx = 0; idx != globals.size(); ++idx)
+        constEvalSetToValue(globals[idx], memo.globals[idx]);
 
-void Compiler::sync(int const addr)
-{
-    assert(d_constEvalEnabled && "Cannot sync when constant evaluation is disabled");
+    if (memo.ret.empty())
+        return -1;
 
-    bool const valueKnown = d_memory.valueKnown(addr);
-    bool const synced     = d_memory.isSync(addr);
-    if (valueKnown && !synced)
-        runtimeSetToValue(addr, d_memory.value(addr));
+    int const ret = allocateTemp(memo.retType);
+    for (int i = 0; i != memo.retType.size(); ++i)
+        constEvalSetToValue(ret + i, memo.ret[i]);
+
+    return ret;
 }
 
-int Compiler::wrapValue(int val)
+int Compiler::callOutOfLine(BFXFunction const &func, std::vector<Instruction> const &args)
 {
-    val %= (MAX_INT + 1);
-    if (val < 0)
-        val += MAX_INT + 1;
+    // Evaluate the arguments. Their types determine which instance is called.
+    std::string key = func.mangled();
+    std::vector<int> argAddrs;
+    for (size_t idx = 0; idx != args.size(); ++idx)
+    {
+        int const argAddr = args[idx]();
+        compilerErrorIf(argAddr < 0,
+                "Invalid argument argument to function \"", func.name(),
+                "\": the expression passed as argument ", idx, " returns void.");
+
+        argAddrs.push_back(argAddr);
+        key += "::" + d_memory.type(argAddr).name();
+    }
+
+    // The function may access the arguments and the globals, so their values
+    // have to be on the tape.
+    std::vector<int> const globals = globalCells();
+
+    if (d_constEvalEnabled)
+    {
+        for (int const addr: argAddrs)
+            sync(addr, d_memory.sizeOf(addr));
+
+        for (int const addr: globals)
+            sync(addr);
+    }
+
+    auto const it = d_instances.find(key);
+    Instance const instance = (it != d_instances.end()) ? it->second : outline(func, key, argAddrs);
+
+    // Pass the arguments through the frame of the instance
+    for (size_t idx = 0; idx != argAddrs.size(); ++idx)
+    {
+        d_liveness.use(argAddrs[idx]);
+        emit(d_bfGen.assign(instance.params[idx], argAddrs[idx], d_memory.sizeOf(argAddrs[idx])));
+    }
+
+    size_t const pointer = d_bfGen.getPointerIndex();
+    d_codeBuffer += d_dispatch.call(instance.routine, pointer);
+    d_dataFlow.resume(pointer, d_memory.cellsRequired());
+    for (int const addr: globals)
+        d_memory.setValueUnknown(addr);
+
+    // Reference parameters are copied back to the arguments
+    auto const &params = func.params();
+    bool returnVariableIsReferenceParameter = false;
+    for (size_t idx = 0; idx != argAddrs.size(); ++idx)
+    {
+        auto const &[paramIdent, paramType] = params[idx];
+        if (paramType != BFXFunction::ParameterType::Reference)
+            continue;
+
+        if (func.returnVariable() == paramIdent)
+            returnVariableIsReferenceParameter = true;
+        
+        runtimeAssign(argAddrs[idx], instance.params[idx], d_memory.sizeOf(argAddrs[idx]));
+    }
+
+    if (func.isVoid() || returnVariableIsReferenceParameter)
+        return -1;
+
+    // Copy the return value out of the frame
+    int const ret = allocateTemp(instance.retType);
+    runtimeAssign(ret, instance.ret, instance.retType.size());
+    
+    return ret;
+}
+
+Compiler::Instance Compiler::outline(BFXFunction const &func, std::string const &key, std::vector<int> const &args)
+{
+    // The body is generated in runtime mode as a routine of its own. Everything
+    // it allocates is placed above the memory in use; these cells (the frame of
+    // the instance) are never used for anything else.
+    
+    Instance instance;
+    instance.routine = d_dispatch.declare();
+
+    disableConstEval();
+    std::string caller;
+    std::swap(caller, d_codeBuffer);
+    SourceMap const sourceMap = d_sourceMap;
+    d_sourceMap.truncate(0);
+    DataFlow const dataFlow = d_dataFlow;
+    size_t const pointer = d_bfGen.getPointerIndex();
+    int const loopUnrolling = std::exchange(d_loopUnrolling, 0);
+    int const floor = d_memory.floor();
+    int const frame = d_memory.cellsRequired();
+    d_memory.setFloor(frame);
+    d_dataFlow.jump(pointer);
+
+    auto const &params = func.params();
+    bool returnVariableIsReferenceParameter = false;
+    for (size_t idx = 0; idx != args.size(); ++idx)
+    {
+        auto const &[paramIdent, paramType] = params[idx];
+        TypeSystem::Type const type = d_memory.type(args[idx]);
+        int const paramAddr = d_memory.allocate(paramIdent, func.mangled(), type,
+                                                d_layout.start(paramIdent, func.mangled()));
+        d_liveness.declare(paramIdent, func.mangled(), paramAddr, type.size());
+        d_layout.declare(paramIdent, func.mangled(), paramAddr, type.size());
+        for (int i = 0; i != type.size(); ++i)
+            d_memory.setValueUnknown(paramAddr + i);
+
+        if (paramType == BFXFunction::ParameterType::Reference)
+        {
+            // Copied back to the argument after the call
+            d_liveness.pin(paramAddr);
+            if (func.returnVariable() == paramIdent)
+                returnVariableIsReferenceParameter = true;
+        }
+        
+        instance.params.push_back(paramAddr);
+    }
+
+    enterScope(func.mangled());
+    func.body()();
+    exitScope(func.mangled());
+
+    if (!(func.isVoid() || returnVariableIsReferenceParameter))
+    {
+        instance.ret = d_memory.find(func.returnVariable(), func.mangled());
+        d_liveness.use(instance.ret);
+        compilerErrorIf(instance.ret == -1,
+                "Returnvalue \"", func.returnVariable(), "\" of function \"", func.name(),
+                "\" seems not to have been declared in the main scope of the function-body.");
+
+        instance.retType = d_memory.type(instance.ret);
+    }
+
+    d_dispatch.define(instance.routine, d_codeBuffer, pointer, d_bfGen.getPointerIndex());
+    d_memory.freeLocals(func.mangled());
+    d_liveness.release(func.mangled());
+    d_layout.release(func.mangled());
+    d_memory.reserve(frame, d_memory.cellsRequired(), "__frame");
+    d_memory.setFloor(floor);
+
+    d_codeBuffer = std::move(caller);
+    d_sourceMap = sourceMap;
+    d_dataFlow = dataFlow;
+    d_bfGen.setPointerIndex(pointer);
+    d_loopUnrolling = loopUnrolling;
+    enableConstEval();
+
+    return d_instances[key] = instance;
+}
+
+int Compiler::constVal(int const num)
+{
+    compilerWarningIf(num > MAX_INT, "use of value ", num, " exceeds limit of ", MAX_INT, ".");
+    
+    int const tmp = allocateTemp();
+    constEvalSetToValue(tmp, num);
+
+    if (!d_constEvalEnabled)
+        runtimeSetToValue(tmp, num);
+
+    return tmp;
+}
+
+int Compiler::declareVariable(std::string const &ident, TypeSystem::Type type)
+{
+    compilerErrorIf(type.isNullType(), "Alias-variable ", ident, " cannot be declared without being initialized." );
+    compilerErrorIf(!type.defined(), "Variable \'", ident, "\' declared with unknown type.");
+    
+    int const sz = type.size();
+    compilerErrorIf(sz == 0, "Cannot declare variable \"", ident, "\" of size 0.");
+    compilerErrorIf(sz < 0,
+            "Size must be specified in declaration without initialization of variable ", ident);
+
+    compilerErrorIf(type.isIntType() && sz > MAX_ARRAY_SIZE,
+                "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+
+    int const addr = allocate(ident, type);
+    d_liveness.uninitialized(addr);
+    return addr;
+}
+
+int Compiler::initializeExpression(std::string const &ident, TypeSystem::Type type, AddressOrInstruction const &rhs)
+{
+    // Check validity of arguments:
+    // 1. Size must not equal 0. -1 is okay; this signals that the size has to be deduced.
+    // 2. If it's an intType, its size cannot exceed the MAX_ARRAY_SIZE.
+    // 3. The type needs te be previously defined, in case of user-defined struct-type.
+    
+    int const sz = type.size();
+    compilerErrorIf(sz == 0, "Cannot declare variable \"", ident, "\" of size 0.");
+    compilerErrorIf(type.isIntType() && sz > MAX_ARRAY_SIZE,
+                    "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+    compilerErrorIf(!type.defined(), "Variable \'", ident, "\' declared with unknown type.");
+
+    // If we're not unrolling a loop, we check if the declared variable does not
+    // already exist in the current scope. Enclosing scopes are allowed to have
+    // a variable of the same name (which will be shadowed by the current one).
+    // When unrolling a loop, this check will not be performed because the same
+    // statement will be executed multiple times.
+
+    if (!d_loopUnrolling)
+    {
+        compilerErrorIf(d_memory.find(ident, d_scope.current(), false) != -1,
+                        "Variable ", ident, " previously declared.");
+    }
+
+    if (type.isNullType())
+    {
+        // Variable was declared without a type, which means it's an alias variable
+        // and no new memory needs to be allocated.
+        compilerErrorIf(rhs < 0, "Use of void expression in assignment.");
+        compilerErrorIf(d_memory.isTemp(rhs), "Cannot create alias to temporary value.");
+        if (!d_loopUnrolling)
+            d_memory.addAlias(rhs, ident, d_scope.current());
+        d_liveness.pin(rhs);
+        return rhs;
+    }
+
+    // If we arrive at this point, a new variable has been declared which needs to
+    // be initialized with the result of the evaluation of rhs, which cannot be void.
+    compilerErrorIf(rhs < 0, "Use of void expression in assignment.");
+
+    // A small optimization can be performed when the rhs cell contains a temporary:
+    // the temp can simply be renamed to avoid the copy. This only works when not in
+    // the middle of loop-unrolling.
+    
+    TypeSystem::Type rhsType = d_memory.type(rhs);
+    if (d_memory.isTemp(rhs) && (sz == -1 || type == rhsType) && !d_loopUnrolling)
+    {
+        // In this situation, we can simply rename the temporary variable that resulted
+        // from evaluating rhs to the declared variable.
+        
+        d_memory.rename(rhs, ident, d_scope.current());
+        d_liveness.declare(ident, d_scope.current(), rhs, rhsType.size());
+        return rhs;
+    }
+    else if (type == rhsType || (type.isIntType() && rhsType.isIntType()))
+    {
+        // rhs is not a temp, so we need to copy the result into a newly allocated
+        // variable.
+        return assign(allocate(ident, (sz != -1) ? type : rhsType), rhs);
+    }
+
+    // If none of the cases matched, this means there's a type-mismatch between the
+    // lhs and rhs of the assignment.
+    compilerError("Type mismatch in assignment of \"", rhsType.name(),
+                  "\" to variable \"", ident, "\" of type \"", type.name(), "\"." );
+    return -1;
+}
+
+void Compiler::sync(int const addr)
+{
+    assert(d_constEvalEnabled && "Cannot sync when constant evaluation is disabled");
+
+    bool const valueKnown = d_memory.valueKnown(addr);
+    bool const synced     = d_memory.isSync(addr);
+    if (valueKnown && !synced)
+        runtimeSetToValue(addr, d_memory.value(addr));
+}
+
+void Compiler::sync(int const start, int const n)
+{
+    assert(d_constEvalEnabled && "Cannot sync when constant evaluation is disabled");
+
+    // Consecutive cells that have to be synced are initialized together
+    auto const needsSync = [this](int const addr)
+                           {
+                               return d_memory.valueKnown(addr) && !d_memory.isSync(addr);
+                           };
+    
+    int i = 0;
+    while (i != n)
+    {
+        if (!needsSync(start + i))
+        {
+            ++i;
+            continue;
+        }
+
+        std::vector<int> values;
+        while (i + (int)values.size() != n && needsSync(start + i + values.size()))
+            values.push_back(d_memory.value(start + i + values.size()));
+
+        runtimeSetToValues(start + i, values);
+        i += values.size();
+    }
+}
+
+int Compiler::wrapValue(int val)
+{
+    val %= (MAX_INT + 1);
+    if (val < 0)
+        val += MAX_INT + 1;
 
     return val;
 }
@@ -701,320 +1482,1226 @@ void Compiler::constEvalSetToValue(int const addr, int const val)
 void Compiler::runtimeSetToValue(int const addr, int const val)
 {
     int newVal = wrapValue(val);
-    d_codeBuffer << d_bfGen.setToValue(addr, newVal);
+    emit(d_bfGen.setToValue(addr, newVal));
     d_memory.value(addr) = newVal;
     d_memory.setSync(addr, true);
 }
 
-void Compiler::runtimeAssign(int const lhs, int const rhs)
+void Compiler::runtimeSetToValues(int const start, std::vector<int> const &values)
+{
+    std::vector<int> wrapped;
+    for (int const val: values)
+        wrapped.push_back(wrapValue(val));
+
+    // Try to initialize the cells from a shared base
+    int best = 0;
+    Estimate bestCost = initCost(wrapped, 0);
+    for (int base = 2; wrapped.size() > 1 && base <= MAX_SHARED_BASE; ++base)
+    {
+        Estimate const cost = initCost(wrapped, base);
+        if (cheaper(cost, bestCost))
+        {
+            best = base;
+            bestCost = cost;
+        }
+    }
+    
+    emit(d_bfGen.setToValues(start, wrapped, best));
+    for (size_t i = 0; i != wrapped.size(); ++i)
+    {
+        d_memory.value(start + i) = wrapped[i];
+        d_memory.setSync(start + i, true);
+    }
+}
+
+Compiler::Estimate Compiler::initCost(std::vector<int> const &values, int const base) const
+{
+    long const n = values.size();
+    if (base == 0)
+    {
+        long size = n;
+        for (int const val: values)
+            size += std::min<long>(val, MAX_INT + 1 - val);
+
+        return {size, size * loopWeight()};
+    }
+
+    long body = 0;
+    long corrections = 0;
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i != n; ++i)
+    {
+        int const k = BFGenerator::multiplier(values[i], base);
+        body += k;
+        corrections += std::abs(values[i] - k * base);
+        if (k != 0)
+        {
+            first = (first == -1) ? i : first;
+            last = i;
+        }
+    }
+
+    // Every iteration walks from the counter to the cells and back
+    long const walk = (first == -1) ? 0 : 2 * (last - first + 1);
+    return {
+            .size  = base + 3 + body + walk + corrections + n,
+            .steps = (base + base * (body + walk + 1) + corrections + n) * loopWeight()
+    };
+}
+
+int Compiler::reuseValue(std::string const &op, int const lhs, int const rhs)
+{
+    if (!d_constEvalAllowed)
+        return -1;
+
+    auto const it = d_values.find({op, valueNumber(lhs), valueNumber(rhs)});
+    if (it == d_values.end())
+        return -1;
+
+    // The temp might have been moved into a function or renamed to a variable
+    Value const &value = it->second;
+    if (!d_memory.isTemp(value.addr) || d_memory.scope(value.addr) != value.scope)
+    {
+        d_values.erase(it);
+        return -1;
+    }
+
+    ++d_valuesReused;
+    return value.addr;
+}
+
+int Compiler::recordValue(std::string const &op, int const lhs, int const rhs, int const result)
 {
-    d_codeBuffer << d_bfGen.assign(lhs, rhs);
-    d_memory.setValueUnknown(lhs);
+    // Only values that are computed at runtime are worth remembering
+    if (!d_constEvalAllowed || !d_memory.isTemp(result) || d_memory.valueKnown(result))
+        return result;
+
+    Value value{result, d_memory.scope(result), {}};
+    for (int const addr: {lhs, rhs})
+    {
+        if (addr >= 0 && valueNumber(addr) == addr)
+            value.operands.emplace_back(addr, addr + d_memory.sizeOf(addr));
+    }
+
+    d_values[{op, valueNumber(lhs), valueNumber(rhs)}] = std::move(value);
+    return result;
+}
+
+int Compiler::valueNumber(int const addr) const
+{
+    // Temps holding a constant (literals) are identified by their value rather
+    // than their address, so that every occurrence of the literal matches.
+    if (addr >= 0 && d_memory.isTemp(addr) && d_memory.sizeOf(addr) == 1 && d_memory.valueKnown(addr))
+        return -2 - d_memory.value(addr);
+
+    return addr;
+}
+
+void Compiler::forgetValues()
+{
+    d_values.clear();
+}
+
+void Compiler::forgetValues(int const addr, int const size)
+{
+    // Forget all values that were computed from or stored in the cells that
+    // are about to be overwritten.
+    std::erase_if(d_values, [&](auto const &pr){
+                                Value const &value = pr.second;
+                                if (value.addr < addr + size && addr < value.addr + 1)
+                                    return true;
+
+                                for (auto const &[begin, end]: value.operands)
+                                {
+                                    if (begin < addr + size && addr < end)
+                                        return true;
+                                }
+                                return false;
+                            });
 }
+
+void Compiler::emit(std::string const &bf)
+{
+    if (d_sourceMap.enabled())
+        d_sourceMap.mark(d_codeBuffer.size(), sourceLocation());
     
-int Compiler::assign(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
+    d_layout.record(bf, d_bfGen.getPointerIndex());
+    d_codeBuffer += d_dataFlow.process(bf, d_bfGen.getPointerIndex(), d_memory.cellsRequired());
+}
+
+void Compiler::beginRuntimeBlock(int const flag, DataFlow::Block const type, Facts const &facts)
+{
+    emit(d_bfGen.movePtr(flag));
+    forgetValues();
+    d_liveness.boundary();
+    d_dataFlow.beginBlock(flag, type, d_codeBuffer.size());
+    for (auto const &[addr, range]: facts)
+        d_dataFlow.assume(addr, range);
+    d_codeBuffer += '[';
+    d_codeBuffer += d_dispatch.block(flag);
+
+    if (type == DataFlow::Block::LOOP)
+    {
+        d_liveness.beginLoop();
+        d_layout.beginLoop();
+        ++d_loopDepth;
+    }
+}
+
+void Compiler::endRuntimeBlock(int const flag)
 {
-    compilerErrorIf(lhs < 0 || rhs < 0, "Use of void expression in assignment.");
+    // Depending on what is known about the flag on entry of the block, the
+    // block might be removed entirely or its brackets can be dropped.
     
-    int const leftSize = d_memory.sizeOf(lhs);
-    int const rightSize = d_memory.sizeOf(rhs);
-    auto const leftType = d_memory.type(lhs);
-    auto const rightType = d_memory.type(rhs);
+    emit(d_bfGen.movePtr(flag));
+    forgetValues();
+    d_liveness.boundary();
+    auto const [type, fold, pos] = d_dataFlow.endBlock();
+    if (type == DataFlow::Block::LOOP)
+    {
+        d_liveness.endLoop();
+        d_layout.endLoop();
+        --d_loopDepth;
+    }
+    
+    switch (fold)
+    {
+    case DataFlow::Fold::KEEP:
+        {
+            d_codeBuffer += ']';
+            break;
+        }
+    case DataFlow::Fold::DROP:
+        {
+            d_codeBuffer.resize(pos);
+            d_sourceMap.truncate(pos);
+            break;
+        }
+    case DataFlow::Fold::UNWRAP:
+        {
+            size_t const len = Dispatch::headerLength(d_codeBuffer, pos);
+            d_codeBuffer.erase(pos, len);
+            d_sourceMap.erase(pos, len);
+            break;
+        }
+    }
+}
+
+Compiler::Facts Compiler::conditionFacts(int const condition) const
+{
+    // A condition that was computed at runtime by comparing a variable to a literal
+    // bounds the value of this variable, whenever the condition holds.
+
+    Facts facts;
+    for (auto const &[key, value]: d_values)
+    {
+        if (value.addr != condition)
+            continue;
+
+        auto [op, lhs, rhs] = key;
+        if (op == "&&")
+        {
+            for (int const operand: {lhs, rhs})
+            {
+                Facts const more = (operand >= 0) ? conditionFacts(operand) : Facts{};
+                facts.insert(facts.end(), more.begin(), more.end());
+            }
+            break;
+        }
+
+        if (lhs < -1 && rhs >= 0)
+        {
+            // Literal on the left-hand side
+            static std::map<std::string, std::string> const flipped{
+                {"<", ">"}, {">", "<"}, {"<=", ">="}, {">=", "<="}, {"==", "=="}
+            };
+
+            auto const it = flipped.find(op);
+            if (it == flipped.end())
+                break;
+            
+            std::swap(lhs, rhs);
+            op = it->second;
+        }
+        
+        if (lhs < 0 || rhs >= -1 || d_memory.isTemp(lhs) || d_memory.sizeOf(lhs) != 1)
+            break;
+
+        long const literal = -2 - rhs;
+        if (op == "<" && literal > 0)
+            facts.emplace_back(lhs, DataFlow::Range{0, literal - 1});
+        else if (op == "<=")
+            facts.emplace_back(lhs, DataFlow::Range{0, literal});
+        else if (op == ">" && literal < MAX_INT)
+            facts.emplace_back(lhs, DataFlow::Range{literal + 1, MAX_INT});
+        else if (op == ">=")
+            facts.emplace_back(lhs, DataFlow::Range{literal, MAX_INT});
+        else if (op == "==")
+            facts.emplace_back(lhs, DataFlow::Range{literal, literal});
+        
+        break;
+    }
+
+    return facts;
+}
+
+bool Compiler::valueKnown(int const addr)
+{
+    // When the value of a cell was computed at runtime, its contents might still
+    // be known from the dataflow analysis of the generated code. This value is
+    // already on the tape, so the cell is in sync.
+    
+    if (d_constEvalEnabled && !d_memory.valueKnown(addr) && d_dataFlow.known(addr) &&
+        d_dataFlow.value(addr) <= std::numeric_limits<int>::max())
+    {
+        d_memory.value(addr) = d_dataFlow.value(addr);
+        d_memory.setSync(addr, true);
+    }
+
+    return d_memory.valueKnown(addr);
+}
+
+void Compiler::runtimeAssign(int const lhs, int const rhs, int const n)
+{
+    emit(d_bfGen.assign(lhs, rhs, n));
+    for (int i = 0; i != n; ++i)
+        d_memory.setValueUnknown(lhs + i);
+}
+    
+int Compiler::assign(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
+{
+    // Evaluating the target of the assignment does not count as reading it
+    d_liveness.beginStore();
+    compilerErrorIf(lhs < 0, "Use of void expression in assignment.");
+    d_liveness.endStore();
+    compilerErrorIf(rhs < 0, "Use of void expression in assignment.");
+    
+    int const leftSize = d_memory.sizeOf(lhs);
+    int const rightSize = d_memory.sizeOf(rhs);
+    auto const leftType = d_memory.type(lhs);
+    auto const rightType = d_memory.type(rhs);
+
+    compilerErrorIf((leftType.isStructType() || rightType.isStructType()) && !(leftType == rightType),
+                    "Incompatible types in assignment: ", leftType.name(), " and ", rightType.name(), ".");
+
+    compilerErrorIf(leftSize != rightSize && leftSize != 1 && rightSize != 1,
+                    "Assignment to array of size ", leftSize,
+                    " with object of incompatible size ", rightSize, ".");
+
+    // When the value is never read, no code has to be generated to store it
+    bool const dead = d_liveness.store(lhs, leftSize) && d_deadStoreEliminationEnabled;
+    bool eliminated = false;
+    auto const runtimeAssign = [&, this](int const dest, int const src, int const n = 1)
+                               {
+                                   if (!dead)
+                                       return this->runtimeAssign(dest, src, n);
+                                   
+                                   for (int i = 0; i != n; ++i)
+                                       d_memory.setValueUnknown(dest + i);
+                                   eliminated = true;
+                               };
+    
+    if (leftSize > 1 && rightSize == 1)
+    {
+        // Fill array with value
+        if (d_constEvalEnabled && valueKnown(rhs))
+        {
+            for (int i = 0; i != leftSize; ++i)
+                constEvalSetToValue(lhs + i, d_memory.value(rhs));
+        }
+        else if (!dead)
+        {
+            emit(d_bfGen.fill(lhs, leftSize, rhs));
+            for (int i = 0; i != leftSize; ++i)
+                d_memory.setValueUnknown(lhs + i);
+        }
+        else
+        {
+            runtimeAssign(lhs, rhs, leftSize);
+        }
+    }
+    else if (leftSize == rightSize)
+    {
+        // Same size -> copy. Runs of cells that are only known at runtime are
+        // copied as a block.
+        int i = 0;
+        while (i != leftSize)
+        {
+            if (d_constEvalEnabled && valueKnown(rhs + i))
+            {
+                constEvalSetToValue(lhs + i, d_memory.value(rhs + i));
+                ++i;
+                continue;
+            }
+
+            int n = 1;
+            while (i + n != leftSize && !(d_constEvalEnabled && valueKnown(rhs + i + n)))
+                ++n;
+
+            runtimeAssign(lhs + i, rhs + i, n);
+            i += n;
+        }
+    }
+    else if (leftSize == 1)
+    {
+        if (d_constEvalEnabled && valueKnown(rhs))
+            constEvalSetToValue(lhs, d_memory.value(rhs));
+        else
+            runtimeAssign(lhs, rhs);
+    }    
+    else
+    {
+        assert(false && "all other cases should have been caught by compiler errors");
+    }
+
+    if (eliminated)
+    {
+        d_deadStores[{filename(), lineNr()}].insert(d_memory.identifier(lhs));
+        ++d_deadStoreCount;
+    }
+    
+    forgetValues(lhs, leftSize);
+    return lhs;
+}
+
+int Compiler::fetch(std::string const &ident)
+{
+    if (isCompileTimeConstant(ident))
+        return constVal(compileTimeConstant(ident));
+    
+    int const addr = addressOf(ident);
+    return addr;
+}
+
+int Compiler::fetchField(std::vector<std::string> const &expr)
+{
+    assert(expr.size() > 1 && "Got field with less than 2 elements");
+    
+    int const addr = addressOf(expr[0]);
+    compilerErrorIf(addr < 0, "Unknown variable \"", expr[0], "\".");
+
+    return fetchFieldImpl(expr, addr, 0);
+}
+
+int Compiler::fetchFieldImpl(std::vector<std::string> const &expr, int const baseAddr, size_t const baseIdx)
+{
+    TypeSystem::Type type = d_memory.type(baseAddr);
+    compilerErrorIf(!type.isStructType(), "Type \"", type.name(), "\" is not a structure.");
+    
+    for (auto const &f: type.fields())
+    {
+        if (f.name == expr[baseIdx + 1])
+        {
+            if (baseIdx + 2 == expr.size())
+                return (baseAddr + f.offset);
+            else
+                return fetchFieldImpl(expr, baseAddr + f.offset, baseIdx + 1);
+        }
+    }
+
+    compilerError("Structure \"", type.name(), "\" does not contain field \"", expr[baseIdx + 1], "\".");
+    return -1;
+}
+
+int Compiler::arrayFromSize(int const sz, Instruction const &fill)
+{
+    compilerErrorIf(sz > MAX_ARRAY_SIZE,
+            "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+
+    return assign(allocateTemp(sz), fill());
+}
+
+int Compiler::arrayFromList(std::vector<Instruction> const &list)
+{
+    int const sz = list.size();
+
+    compilerErrorIf(sz > MAX_ARRAY_SIZE,
+            "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+
+    std::vector<std::pair<int, int>> runtimeElements; // {index, address}
+    int start = allocateTemp(sz);
+    for (int idx = 0; idx != sz; ++idx)
+    {
+        int const elementAddr = list[idx]();
+        if (d_constEvalEnabled && valueKnown(elementAddr))
+        {
+            constEvalSetToValue(start + idx, d_memory.value(elementAddr));
+        }
+        else
+            runtimeElements.push_back({idx, elementAddr});
+    }
+
+    // Elements that are stored next to each other are copied as a block
+    size_t i = 0;
+    while (i != runtimeElements.size())
+    {
+        auto const [elementIdx, elementAddr] = runtimeElements[i];
+        int n = 1;
+        while (i + n != runtimeElements.size() &&
+               runtimeElements[i + n].first == elementIdx + n &&
+               runtimeElements[i + n].second == elementAddr + n)
+            ++n;
+
+        runtimeAssign(start + elementIdx, elementAddr, n);
+        i += n;
+    }
+
+    return start;
+}
+
+int Compiler::arrayFromString(std::string const &str)
+{
+    int const sz = str.size();
+
+    compilerErrorIf(sz > MAX_ARRAY_SIZE,
+            "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+
+    int const start = allocateTemp(sz);
+    for (int idx = 0; idx != sz; ++idx)
+        constEvalSetToValue(start + idx, str[idx]);
+
+    if (!d_constEvalEnabled)
+        runtimeSetToValues(start, std::vector<int>(str.begin(), str.end()));
+
+    return start;
+}
+
+int Compiler::anonymousStructObject(std::string const name, std::vector<Instruction> const &values)
+{
+    TypeSystem::Type type(name);
+    compilerErrorIf(!type.defined(), "Unknown (struct) type \"", name, "\".");
+
+    auto const &fields = type.fields();
+    compilerErrorIf(values.size() > fields.size(),
+            "Too many field-initializers provided to struct \"", name, "\": ",
+            "expects ", fields.size(), ", got ", values.size(), ".");
+
+    int const addr = allocateTemp(type);
+    for (size_t i = 0; i != values.size(); ++i)
+    {
+        auto const &field = fields[i];
+        
+        int val = values[i]();
+        TypeSystem::Type valType = d_memory.type(val);
+        TypeSystem::Type fieldType = field.type;
+        
+        compilerErrorIf(!(valType == fieldType),
+                "Type mismatch in initialization of \"", name , ".", field.name, "\".");
+
+        assign(addr + field.offset, val);
+    }
+
+    return addr;
+}
+
+
+int Compiler::fetchElement(AddressOrInstruction const &arr, AddressOrInstruction const &index)
+{
+    int const indexValue = d_memory.value(index);
+    int const sz = d_memory.sizeOf(arr);
+    compilerWarningIf(d_boundsCheckingEnabled && indexValue >= sz,
+              "Array index (", indexValue, ") out of bounds: sizeof(",
+              d_memory.identifier(arr), ") = ", sz, ".");
+
+    if (d_constEvalEnabled && valueKnown(index))
+    {
+        return arr + d_memory.value(index);
+    }
+    else
+    {
+        int const reused = reuseValue("[]", arr, index);
+        if (reused != -1)
+            return reused;
+        
+        if (d_constEvalEnabled)
+        {
+            sync(index);
+            sync(arr, sz);
+        }
+        
+        int const ret = allocateTemp();
+        auto const [first, last] = reachableElements(arr, index);
+        emit(d_bfGen.fetchElement(arr + first, last - first + 1, index, ret, first));
+        d_memory.setValueUnknown(ret);
+        return recordValue("[]", arr, index, ret);
+    }
+}
+
+int Compiler::assignElement(AddressOrInstruction const &arr, AddressOrInstruction const &index, AddressOrInstruction const &rhs)
+{
+    int const indexValue = d_memory.value(index);
+    int const sz = d_memory.sizeOf(arr);
+    compilerWarningIf(d_boundsCheckingEnabled && indexValue >= sz,
+              "Array index (", indexValue, ") out of bounds: sizeof(",
+              d_memory.identifier(arr), ") = ", sz, ".");
+    
+    if (d_constEvalEnabled && valueKnown(index) && valueKnown(rhs))
+    {
+        // Case 1: index and rhs both known
+        int const addr = arr + d_memory.value(index);
+        constEvalSetToValue(addr, d_memory.value(rhs));
+        forgetValues(addr);
+        return addr;
+    }
+    else if (d_constEvalEnabled && valueKnown(index))
+    {
+        // Case 2: only index known
+        sync(rhs);
+        int const addr = arr + d_memory.value(index);
+
+        emit(d_bfGen.assign(addr, rhs));
+        d_memory.setValueUnknown(addr);
+        forgetValues(addr);
+        return addr;
+    }
+    else
+    {
+        // Case 3: Index unkown or constant evaluation is disabled ->
+        // make sure index and rhs are synced and use full algorithm .
+        // This may alter any of the array elements -> set all elements to unknown status.
+        
+        if (d_constEvalEnabled)
+        {
+            sync(index);
+            sync(rhs);
+            sync(arr, sz);
+        }
+        
+        auto const [first, last] = reachableElements(arr, index);
+        emit(d_bfGen.assignElement(arr + first, last - first + 1, index, rhs, first));
+        for (int i = 0; i != sz; ++i)
+            d_memory.setValueUnknown(arr + i);
+        forgetValues(arr, sz);
+
+        // Attention: can't return the address of the modified cell, so we return the
+        // address of the known RHS-cell.
+        return rhs;
+    }
+}
+
+
+std::pair<int, int> Compiler::reachableElements(int const arr, int const index) const
+{
+    // Only the elements that the index can refer to, according to what is known
+    // about its value at runtime, have to be covered by the array walk.
+    
+    int const sz = d_memory.sizeOf(arr);
+    DataFlow::Range const range = d_dataFlow.bounds(index);
+    compilerWarningIf(d_boundsCheckingEnabled && range.lo >= sz,
+                      "Array index (at least ", range.lo, ") out of bounds: sizeof(",
+                      d_memory.identifier(arr), ") = ", sz, ".");
+
+    if (range.lo >= sz)
+        return {0, sz - 1};
+
+    return {range.lo, std::min<long>(range.hi, sz - 1)};
+}
+
+int Compiler::applyUnaryFunctionToElement(AddressOrInstruction const &arr,
+                                          AddressOrInstruction const &index,
+                                          UnaryFunction func)
+{
+    // The element is modified in place, so it must not be shared with an earlier
+    // fetch of the same element.
+    forgetValues(arr, d_memory.sizeOf(arr));
+    int const copyOfElement = fetchElement(arr, index);
+    int const returnVal = (this->*func)(copyOfElement);
+    assignElement(arr, index, copyOfElement);
+    return returnVal;
+}
+
+int Compiler::applyBinaryFunctionToElement(AddressOrInstruction const &arr,
+                                           AddressOrInstruction const &index,
+                                           AddressOrInstruction const &rhs,
+                                           BinaryFunction func)
+{
+    forgetValues(arr, d_memory.sizeOf(arr));
+    int const fetchedAddr = fetchElement(arr, index);
+    int const returnAddr  = (this->*func)(fetchedAddr, rhs);
+    assignElement(arr, index, fetchedAddr);
+    return returnAddr;
+}
+
+int Compiler::scanCell()
+{
+    int const addr = allocateTemp();
+    emit(d_bfGen.scan(addr));
+    d_memory.setValueUnknown(addr);
+    return addr;
+}
+
+int Compiler::printCell(AddressOrInstruction const &target)
+{
+    
+    if (d_constEvalEnabled)
+        sync(target);
+    
+    emit(d_bfGen.print(target));
+    return target;
+}
+
+bool Compiler::isConstant(int const addr)
+{
+    // Outside a constant context, only temporaries (literals and const-identifiers)
+    // are guaranteed to hold the value they were assigned.
+    return d_constEvalEnabled ? valueKnown(addr) :
+        (d_memory.isTemp(addr) && d_memory.valueKnown(addr));
+}
+
+int Compiler::printString(std::vector<Instruction> const &args)
+{
+    // Prints the cells of its argument up to the first zero.
+    
+    int const str = args[0]();
+    compilerErrorIf(str < 0, "Use of void-expression in call to __prints.");
+
+    int const sz = d_memory.sizeOf(str);
+    std::vector<int> values;
+    bool known = true;
+    bool synced = true;
+    for (int i = 0; i != sz && known; ++i)
+    {
+        int const addr = str + i;
+        known = isConstant(addr);
+
+        if (!known || d_memory.value(addr) == 0)
+            break;
+
+        values.push_back(d_memory.value(addr));
+        synced = synced && d_memory.isSync(addr);
+    }
+
+    if (!known)
+    {
+        // Contents are only known at runtime
+        if (d_constEvalEnabled)
+            sync(str, sz);
+        
+        emit(d_bfGen.printString(str, sz));
+    }
+    else if (synced)
+    {
+        // Contents are on the tape already
+        for (size_t i = 0; i != values.size(); ++i)
+            emit(d_bfGen.print(str + i));
+    }
+    else if (!values.empty())
+    {
+        // Stream the characters through a single cell
+        int const tmp = allocateTemp(1, d_bfGen.getPointerIndex());
+        emit(d_bfGen.printValues(tmp, values));
+        d_memory.setValueUnknown(tmp);
+    }
+
+    return -1;
+}
+
+int Compiler::printDecimal(std::vector<Instruction> const &args)
+{
+    int const x = args[0]();
+    compilerErrorIf(x < 0, "Use of void-expression in call to __printd.");
+
+    if (isConstant(x))
+    {
+        std::string const str = std::to_string(d_memory.value(x));
+        int const tmp = allocateTemp(1, d_bfGen.getPointerIndex());
+        emit(d_bfGen.printValues(tmp, std::vector<int>(str.begin(), str.end())));
+        d_memory.setValueUnknown(tmp);
+        return -1;
+    }
+
+    if (d_constEvalEnabled)
+        sync(x);
+
+    emit(d_bfGen.printDecimal(x));
+    return -1;
+}
+
+int Compiler::toDecimalString(std::vector<Instruction> const &args)
+{
+    int const x = args[0]();
+    int const n = args[1]();
+    compilerErrorIf(x < 0 || n < 0, "Use of void-expression in call to __to_string.");
+    compilerErrorIf(!isConstant(n) || d_memory.value(n) < 1 || d_memory.value(n) > 10,
+                    "Second argument to __to_string must be a constant between 1 and 10.");
+
+    // Digits that don't fit in the string are dropped
+    int const nDigits = d_memory.value(n);
+    if (isConstant(x))
+    {
+        long mod = 1;
+        for (int i = 0; i != nDigits; ++i)
+            mod *= 10;
+
+        std::string const digits = std::to_string(d_memory.value(x) % mod);
+        std::vector<int> values(nDigits, 0);
+        std::copy(digits.begin(), digits.end(), values.begin());
+        return constArray(values);
+    }
+
+    int const str = allocateTemp(nDigits);
+
+    if (d_constEvalEnabled)
+        sync(x);
+
+    emit(d_bfGen.toDecimalString(x, str, nDigits));
+    for (int i = 0; i != nDigits; ++i)
+        d_memory.setValueUnknown(str + i);
+
+    return str;
+}
+
+bool Compiler::knownString(int const str, std::vector<int> &values)
+{
+    // Collects the contents of str up to the terminating zero (or the end of the
+    // array), if all of these are known at compiletime.
+    
+    values.clear();
+    int const sz = d_memory.sizeOf(str);
+    for (int i = 0; i != sz; ++i)
+    {
+        if (!isConstant(str + i))
+            return false;
+
+        if (d_memory.value(str + i) == 0)
+            break;
+
+        values.push_back(d_memory.value(str + i));
+    }
+
+    return true;
+}
+
+int Compiler::stringLength(std::vector<Instruction> const &args)
+{
+    int const str = args[0]();
+    compilerErrorIf(str < 0, "Use of void-expression in call to __strlen.");
+
+    std::vector<int> values;
+    if (knownString(str, values))
+        return constVal(values.size());
+
+    int const sz = d_memory.sizeOf(str);
+    if (d_constEvalEnabled)
+        sync(str, sz);
+
+    int const ret = allocateTemp();
+    emit(d_bfGen.stringLength(str, sz, ret));
+    d_memory.setValueUnknown(ret);
+    return ret;
+}
 
-    compilerErrorIf((leftType.isStructType() || rightType.isStructType()) && !(leftType == rightType),
-                    "Incompatible types in assignment: ", leftType.name(), " and ", rightType.name(), ".");
+int Compiler::stringCompare(std::vector<Instruction> const &args)
+{
+    int const lhs = args[0]();
+    int const rhs = args[1]();
+    compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in call to __strcmp.");
 
-    compilerErrorIf(leftSize != rightSize && leftSize != 1 && rightSize != 1,
-                    "Assignment to array of size ", leftSize,
-                    " with object of incompatible size ", rightSize, ".");
+    if (lhs == rhs)
+        return constVal(1);
     
-    if (leftSize > 1 && rightSize == 1)
+    std::vector<int> lhsValues, rhsValues;
+    if (knownString(lhs, lhsValues) && knownString(rhs, rhsValues))
+        return constVal(lhsValues == rhsValues);
+
+    int const lhsSize = d_memory.sizeOf(lhs);
+    int const rhsSize = d_memory.sizeOf(rhs);
+    if (d_constEvalEnabled)
     {
-        // Fill array with value
-        if (d_constEvalEnabled && d_memory.valueKnown(rhs))
-        {
-            for (int i = 0; i != leftSize; ++i)
-                constEvalSetToValue(lhs + i, d_memory.value(rhs));
-        }
-        else
-        {
-            for (int i = 0; i != leftSize; ++i)
-                runtimeAssign(lhs + i, rhs);
-        }
+        sync(lhs, lhsSize);
+        sync(rhs, rhsSize);
     }
-    else if (leftSize == rightSize)
+
+    int const ret = allocateTemp();
+    emit(d_bfGen.stringCompare(lhs, lhsSize, rhs, rhsSize, ret));
+    d_memory.setValueUnknown(ret);
+    return ret;
+}
+
+int Compiler::stringCopy(std::vector<Instruction> const &args)
+{
+    int const dest = args[0]();
+    int const src = args[1]();
+    compilerErrorIf(dest < 0 || src < 0, "Use of void-expression in call to __strcpy.");
+
+    // Never writes beyond the end of the destination
+    int const n = std::min(d_memory.sizeOf(dest), d_memory.sizeOf(src));
+    if (dest == src)
+        return stringLength({[=]{ return src; }});
+
+    std::vector<int> values;
+    if (knownString(src, values))
     {
-        // Same size -> copy
+        values.resize(std::min<int>(values.size(), n));
         if (d_constEvalEnabled)
         {
-            for (int i = 0; i != leftSize; ++i)
-            {
-                if (d_memory.valueKnown(rhs + i))
-                    constEvalSetToValue(lhs + i, d_memory.value(rhs + i));
-                else
-                    runtimeAssign(lhs + i, rhs + i);
-            }
-        }
-        else
-        {
-            for (int i = 0; i != leftSize; ++i)
-                runtimeAssign(lhs + i, rhs + i);
+            for (size_t i = 0; i != values.size(); ++i)
+                constEvalSetToValue(dest + i, values[i]);
         }
+        else if (!values.empty())
+            runtimeSetToValues(dest, values);
+
+        forgetValues(dest, values.size());
+        return constVal(values.size());
     }
-    else if (leftSize == 1)
-    {
-        if (d_constEvalEnabled && d_memory.valueKnown(rhs))
-            constEvalSetToValue(lhs, d_memory.value(rhs));
-        else
-            runtimeAssign(lhs, rhs);
-    }    
-    else
+
+    if (d_constEvalEnabled)
     {
-        assert(false && "all other cases should have been caught by compiler errors");
+        sync(src, n);
+        sync(dest, n);
     }
 
-    return lhs;
-}
+    int const ret = allocateTemp();
+    emit(d_bfGen.stringCopy(dest, src, n, ret));
+    for (int i = 0; i != n; ++i)
+        d_memory.setValueUnknown(dest + i);
 
-int Compiler::fetch(std::string const &ident)
-{
-    if (isCompileTimeConstant(ident))
-        return constVal(compileTimeConstant(ident));
-    
-    int const addr = addressOf(ident);
-    return addr;
+    d_memory.setValueUnknown(ret);
+    forgetValues(dest, n);
+    return ret;
 }
 
-int Compiler::fetchField(std::vector<std::string> const &expr)
+int Compiler::memorySet(std::vector<Instruction> const &args)
 {
-    assert(expr.size() > 1 && "Got field with less than 2 elements");
-    
-    int const addr = addressOf(expr[0]);
-    compilerErrorIf(addr < 0, "Unknown variable \"", expr[0], "\".");
+    int const dest = args[0]();
+    int const val = args[1]();
+    compilerErrorIf(dest < 0 || val < 0, "Use of void-expression in call to __memset.");
+    compilerErrorIf(d_memory.sizeOf(val) != 1, "Second argument to __memset must be an integer.");
 
-    return fetchFieldImpl(expr, addr, 0);
+    assign(dest, val);
+    return -1;
 }
 
-int Compiler::fetchFieldImpl(std::vector<std::string> const &expr, int const baseAddr, size_t const baseIdx)
+int Compiler::memoryCopy(std::vector<Instruction> const &args)
 {
-    TypeSystem::Type type = d_memory.type(baseAddr);
-    compilerErrorIf(!type.isStructType(), "Type \"", type.name(), "\" is not a structure.");
-    
-    for (auto const &f: type.fields())
+    int const dest = args[0]();
+    int const src = args[1]();
+    compilerErrorIf(dest < 0 || src < 0, "Use of void-expression in call to __memcpy.");
+
+    int const destSize = d_memory.sizeOf(dest);
+    int const srcSize = d_memory.sizeOf(src);
+    if (destSize == srcSize)
     {
-        if (f.name == expr[baseIdx + 1])
+        assign(dest, src);
+        return -1;
+    }
+
+    // Copy the common part; runs of cells that are only known at runtime are
+    // copied as a block.
+    int const n = std::min(destSize, srcSize);
+    int i = 0;
+    while (i != n)
+    {
+        if (d_constEvalEnabled && valueKnown(src + i))
         {
-            if (baseIdx + 2 == expr.size())
-                return (baseAddr + f.offset);
-            else
-                return fetchFieldImpl(expr, baseAddr + f.offset, baseIdx + 1);
+            constEvalSetToValue(dest + i, d_memory.value(src + i));
+            ++i;
+            continue;
         }
+
+        int k = 1;
+        while (i + k != n && !(d_constEvalEnabled && valueKnown(src + i + k)))
+            ++k;
+
+        runtimeAssign(dest + i, src + i, k);
+        i += k;
     }
 
-    compilerError("Structure \"", type.name(), "\" does not contain field \"", expr[baseIdx + 1], "\".");
+    forgetValues(dest, n);
     return -1;
 }
 
-int Compiler::arrayFromSize(int const sz, Instruction const &fill)
+bool Compiler::knownDigits(int const start, std::vector<long> &digits)
 {
-    compilerErrorIf(sz > MAX_ARRAY_SIZE,
-            "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+    digits.clear();
+    int const sz = d_memory.sizeOf(start);
+    for (int i = 0; i != sz; ++i)
+    {
+        if (!isConstant(start + i))
+            return false;
 
-    return assign(allocateTemp(sz), fill());
+        digits.push_back(d_memory.value(start + i));
+    }
+
+    return true;
 }
 
-int Compiler::arrayFromList(std::vector<Instruction> const &list)
+int Compiler::constArray(std::vector<int> const &values)
 {
-    int const sz = list.size();
+    int const ret = allocateTemp(values.size());
+    if (d_constEvalEnabled)
+    {
+        for (size_t i = 0; i != values.size(); ++i)
+            constEvalSetToValue(ret + i, values[i]);
+    }
+    else
+        runtimeSetToValues(ret, values);
 
-    compilerErrorIf(sz > MAX_ARRAY_SIZE,
-            "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+    return ret;
+}
 
-    std::vector<std::pair<int, int>> runtimeElements; // {index, address}
-    int start = allocateTemp(sz);
-    for (int idx = 0; idx != sz; ++idx)
+int Compiler::bigFromInt(std::vector<Instruction> const &args)
+{
+    int const x = args[0]();
+    int const n = args[1]();
+    compilerErrorIf(x < 0 || n < 0, "Use of void-expression in call to __big.");
+    compilerErrorIf(d_memory.sizeOf(x) != 1, "First argument to __big must be an integer.");
+    compilerErrorIf(!isConstant(n) || d_memory.value(n) < 1,
+                    "Second argument to __big must be a positive constant.");
+
+    int const sz = d_memory.value(n);
+    if (isConstant(x))
     {
-        int const elementAddr = list[idx]();
-        if (d_constEvalEnabled && d_memory.valueKnown(elementAddr))
-        {
-            constEvalSetToValue(start + idx, d_memory.value(elementAddr));
-        }
-        else
-            runtimeElements.push_back({idx, elementAddr});
+        std::vector<int> values(sz, 0);
+        values[0] = d_memory.value(x);
+        return constArray(values);
     }
 
-    for (auto const &pr: runtimeElements)
+    int const ret = allocateTemp(sz);
+    runtimeAssign(ret, x);
+    for (int i = 1; i != sz; ++i)
     {
-        auto const [elementIdx, elementAddr] = pr;
-        d_codeBuffer << d_bfGen.assign(start + elementIdx, elementAddr);
-        d_memory.setValueUnknown(start + elementIdx);
+        if (d_constEvalEnabled)
+            constEvalSetToValue(ret + i, 0);
+        else
+            runtimeSetToValue(ret + i, 0);
     }
 
-    return start;
+    return ret;
 }
 
-int Compiler::arrayFromString(std::string const &str)
+int Compiler::bigArithmetic(std::string const &name, std::vector<Instruction> const &args, bool const scalar,
+                            BigFold const &fold, BigCode const &code)
 {
-    int const sz = str.size();
-
-    compilerErrorIf(sz > MAX_ARRAY_SIZE,
-            "Maximum array size (", MAX_ARRAY_SIZE, ") exceeded (got ", sz, ").");
+    // Common implementation of the binary operations on multi-cell integers. The
+    // result has as many cells as the left operand, or a single cell for comparisons.
+    
+    int const lhs = args[0]();
+    int const rhs = args[1]();
+    compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in call to ", name, ".");
+
+    int const nLhs = d_memory.sizeOf(lhs);
+    int const nRhs = d_memory.sizeOf(rhs);
+    std::vector<long> x, y;
+    if (knownDigits(lhs, x) && knownDigits(rhs, y))
+    {
+        std::vector<long> const result = fold(x, y, MAX_INT + 1);
+        return constArray(std::vector<int>(result.begin(), result.end()));
+    }
 
-    int const start = allocateTemp(sz);
-    for (int idx = 0; idx != sz; ++idx)
+    if (d_constEvalEnabled)
     {
-        constEvalSetToValue(start + idx, str[idx]);
-        if (!d_constEvalEnabled)
-            runtimeSetToValue(start + idx, str[idx]);
+        sync(lhs, nLhs);
+        sync(rhs, nRhs);
     }
 
-    return start;
+    int const n = scalar ? 1 : nLhs;
+    int const ret = allocateTemp(n);
+    emit(code(lhs, nLhs, rhs, nRhs, ret));
+    for (int i = 0; i != n; ++i)
+        d_memory.setValueUnknown(ret + i);
+
+    return ret;
 }
 
-int Compiler::anonymousStructObject(std::string const name, std::vector<Instruction> const &values)
+int Compiler::bigAdd(std::vector<Instruction> const &args)
 {
-    TypeSystem::Type type(name);
-    compilerErrorIf(!type.defined(), "Unknown (struct) type \"", name, "\".");
+    auto fold = [](auto const &x, auto const &y, long const base){
+                    return _BigNum::add(x, y, base, false);
+                };
 
-    auto const &fields = type.fields();
-    compilerErrorIf(values.size() > fields.size(),
-            "Too many field-initializers provided to struct \"", name, "\": ",
-            "expects ", fields.size(), ", got ", values.size(), ".");
+    auto code = [this](int lhs, int nLhs, int rhs, int nRhs, int ret){
+                    return d_bfGen.bigAdd(lhs, nLhs, rhs, nRhs, ret);
+                };
 
-    int const addr = allocateTemp(type);
-    for (size_t i = 0; i != values.size(); ++i)
-    {
-        auto const &field = fields[i];
-        
-        int val = values[i]();
-        TypeSystem::Type valType = d_memory.type(val);
-        TypeSystem::Type fieldType = field.type;
-        
-        compilerErrorIf(!(valType == fieldType),
-                "Type mismatch in initialization of \"", name , ".", field.name, "\".");
+    return bigArithmetic("__big_add", args, false, fold, code);
+}
 
-        assign(addr + field.offset, val);
-    }
+int Compiler::bigSubtract(std::vector<Instruction> const &args)
+{
+    auto fold = [](auto const &x, auto const &y, long const base){
+                    return _BigNum::add(x, y, base, true);
+                };
 
-    return addr;
+    auto code = [this](int lhs, int nLhs, int rhs, int nRhs, int ret){
+                    return d_bfGen.bigAdd(lhs, nLhs, rhs, nRhs, ret, true);
+                };
+
+    return bigArithmetic("__big_sub", args, false, fold, code);
 }
 
+int Compiler::bigMultiply(std::vector<Instruction> const &args)
+{
+    auto fold = [](auto const &x, auto const &y, long const base){
+                    return _BigNum::multiply(x, y, base);
+                };
 
-int Compiler::fetchElement(AddressOrInstruction const &arr, AddressOrInstruction const &index)
+    auto code = [this](int lhs, int nLhs, int rhs, int nRhs, int ret){
+                    return d_bfGen.bigMultiply(lhs, nLhs, rhs, nRhs, ret);
+                };
+
+    return bigArithmetic("__big_mul", args, false, fold, code);
+}
+
+int Compiler::bigLess(std::vector<Instruction> const &args)
 {
-    int const indexValue = d_memory.value(index);
-    int const sz = d_memory.sizeOf(arr);
-    compilerWarningIf(d_boundsCheckingEnabled && indexValue >= sz,
-              "Array index (", indexValue, ") out of bounds: sizeof(",
-              d_memory.identifier(arr), ") = ", sz, ".");
+    auto fold = [](auto const &x, auto const &y, long){
+                    return std::vector<long>{_BigNum::compare(x, y) < 0};
+                };
 
-    if (d_constEvalEnabled && d_memory.valueKnown(index))
-    {
-        return arr + d_memory.value(index);
-    }
-    else
+    auto code = [this](int lhs, int nLhs, int rhs, int nRhs, int ret){
+                    return d_bfGen.bigLess(lhs, nLhs, rhs, nRhs, ret);
+                };
+
+    return bigArithmetic("__big_less", args, true, fold, code);
+}
+
+int Compiler::bigEqual(std::vector<Instruction> const &args)
+{
+    auto fold = [](auto const &x, auto const &y, long){
+                    return std::vector<long>{_BigNum::compare(x, y) == 0};
+                };
+
+    auto code = [this](int lhs, int nLhs, int rhs, int nRhs, int ret){
+                    return d_bfGen.bigEqual(lhs, nLhs, rhs, nRhs, ret);
+                };
+
+    return bigArithmetic("__big_equal", args, true, fold, code);
+}
+
+int Compiler::bigPrintDecimal(std::vector<Instruction> const &args)
+{
+    int const x = args[0]();
+    compilerErrorIf(x < 0, "Use of void-expression in call to __big_printd.");
+
+    int const sz = d_memory.sizeOf(x);
+    std::vector<long> digits;
+    if (knownDigits(x, digits))
     {
-        if (d_constEvalEnabled)
-        {
-            sync(index);
-            for (int i = 0; i != sz; ++i)
-                sync(arr + i);
-        }
-        
-        int const ret = allocateTemp();
-        d_codeBuffer << d_bfGen.fetchElement(arr, sz, index, ret);
-        d_memory.setValueUnknown(ret);
-        return ret;
+        std::string const str = _BigNum::toString(digits, MAX_INT + 1);
+        int const tmp = allocateTemp(1, d_bfGen.getPointerIndex());
+        emit(d_bfGen.printValues(tmp, std::vector<int>(str.begin(), str.end())));
+        d_memory.setValueUnknown(tmp);
+        return -1;
     }
+
+    // Every division by 10 counts the cells down, which takes as many steps as
+    // their values: on cells wider than a byte this takes impractically long.
+    compilerWarningIf(d_cellType != CellType::INT8,
+                      "__big_printd on ", d_cellType, " cells is only practical for small values; "
+                      "multi-cell integers are meant to be used with int8 cells.");
+
+    if (d_constEvalEnabled)
+        sync(x, sz);
+
+    emit(d_bfGen.bigPrintDecimal(x, sz));
+    return -1;
 }
 
-int Compiler::assignElement(AddressOrInstruction const &arr, AddressOrInstruction const &index, AddressOrInstruction const &rhs)
+int Compiler::bitAnd(std::vector<Instruction> const &args)
 {
-    int const indexValue = d_memory.value(index);
-    int const sz = d_memory.sizeOf(arr);
-    compilerWarningIf(d_boundsCheckingEnabled && indexValue >= sz,
-              "Array index (", indexValue, ") out of bounds: sizeof(",
-              d_memory.identifier(arr), ") = ", sz, ".");
-    
-    if (d_constEvalEnabled && d_memory.valueKnown(index) && d_memory.valueKnown(rhs))
+    int const lhs = args[0]();
+    int const rhs = args[1]();
+    checkBitwiseOperands("__and", lhs, rhs);
+
+    // Masking with all bits set is a no-op (e.g. the bit8_* functions on 8-bit cells)
+    for (auto const &[mask, value]: {std::pair{lhs, rhs}, std::pair{rhs, lhs}})
     {
-        // Case 1: index and rhs both known
-        int const addr = arr + d_memory.value(index);
-        constEvalSetToValue(addr, d_memory.value(rhs));
-        return addr;
+        if (isConstant(mask) && d_memory.value(mask) == MAX_INT)
+            return assign(allocateTemp(), value);
     }
-    else if (d_constEvalEnabled && d_memory.valueKnown(index))
-    {
-        // Case 2: only index known
-        sync(rhs);
-        int const addr = arr + d_memory.value(index);
+    
+    int const ret = allocateTemp();
+    auto bf  = [&, this](){
+                   emit(d_bfGen.bitAnd(lhs, rhs, ret));
+               };
 
-        d_codeBuffer << d_bfGen.assign(addr, rhs);
-        d_memory.setValueUnknown(addr);
-        return addr;
-    }
-    else
-    {
-        // Case 3: Index unkown or constant evaluation is disabled ->
-        // make sure index and rhs are synced and use full algorithm .
-        // This may alter any of the array elements -> set all elements to unknown status.
-        
-        if (d_constEvalEnabled)
-        {
-            sync(index);
-            sync(rhs);
-            for (int i = 0; i != sz; ++i)
-                sync(arr + i);
-        }
-        
-        d_codeBuffer << d_bfGen.assignElement(arr, sz, index, rhs);
-        for (int i = 0; i != sz; ++i)
-            d_memory.setValueUnknown(arr + i);
+    auto func = [](int x, int y){
+                    return x & y;
+                };
 
-        // Attention: can't return the address of the modified cell, so we return the
-        // address of the known RHS-cell.
-        return rhs;
-    }
+    return eval<0b00>(bf, func, ret, lhs, rhs);
 }
 
+int Compiler::bitOr(std::vector<Instruction> const &args)
+{
+    int const lhs = args[0]();
+    int const rhs = args[1]();
+    checkBitwiseOperands("__or", lhs, rhs);
+
+    int const ret = allocateTemp();
+    auto bf  = [&, this](){
+                   emit(d_bfGen.bitOr(lhs, rhs, ret));
+               };
+
+    auto func = [](int x, int y){
+                    return x | y;
+                };
+
+    return eval<0b00>(bf, func, ret, lhs, rhs);
+}
 
-int Compiler::applyUnaryFunctionToElement(AddressOrInstruction const &arr,
-                                          AddressOrInstruction const &index,
-                                          UnaryFunction func)
+int Compiler::bitXor(std::vector<Instruction> const &args)
 {
-    int const copyOfElement = fetchElement(arr, index);
-    int const returnVal = (this->*func)(copyOfElement);
-    assignElement(arr, index, copyOfElement);
-    return returnVal;
+    int const lhs = args[0]();
+    int const rhs = args[1]();
+    checkBitwiseOperands("__xor", lhs, rhs);
+
+    int const ret = allocateTemp();
+    auto bf  = [&, this](){
+                   emit(d_bfGen.bitXor(lhs, rhs, ret));
+               };
+
+    auto func = [](int x, int y){
+                    return x ^ y;
+                };
+
+    return eval<0b00>(bf, func, ret, lhs, rhs);
 }
 
-int Compiler::applyBinaryFunctionToElement(AddressOrInstruction const &arr,
-                                           AddressOrInstruction const &index,
-                                           AddressOrInstruction const &rhs,
-                                           BinaryFunction func)
+int Compiler::shiftLeft(std::vector<Instruction> const &args)
 {
-    int const fetchedAddr = fetchElement(arr, index);
-    int const returnAddr  = (this->*func)(fetchedAddr, rhs);
-    assignElement(arr, index, fetchedAddr);
-    return returnAddr;
+    int const lhs = args[0]();
+    int const rhs = args[1]();
+    checkBitwiseOperands("__shl", lhs, rhs);
+
+    int const ret = allocateTemp();
+    auto bf  = [&, this](){
+                   emit(d_bfGen.shiftLeft(lhs, rhs, ret));
+               };
+
+    auto func = [this](int x, int n){
+                    // Bits shifted beyond the width of the cell are lost
+                    return (n >= 32) ? 0 : (int)(((long)x << n) & MAX_INT);
+                };
+
+    return eval<0b00>(bf, func, ret, lhs, rhs);
 }
 
-int Compiler::scanCell()
+int Compiler::shiftRight(std::vector<Instruction> const &args)
 {
-    int const addr = allocateTemp();
-    d_codeBuffer << d_bfGen.scan(addr);
-    d_memory.setValueUnknown(addr);
-    return addr;
+    int const lhs = args[0]();
+    int const rhs = args[1]();
+    checkBitwiseOperands("__shr", lhs, rhs);
+
+    int const ret = allocateTemp();
+    auto bf  = [&, this](){
+                   emit(d_bfGen.shiftRight(lhs, rhs, ret));
+               };
+
+    auto func = [](int x, int n){
+                    return (n >= 32) ? 0 : (int)((unsigned)x >> n);
+                };
+
+    return eval<0b00>(bf, func, ret, lhs, rhs);
 }
 
-int Compiler::printCell(AddressOrInstruction const &target)
+void Compiler::checkBitwiseOperands(std::string const &name, int const lhs, int const rhs)
 {
-    
-    if (d_constEvalEnabled)
-        sync(target);
-    
-    d_codeBuffer << d_bfGen.print(target);
-    return target;
+    compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in call to ", name, ".");
+    compilerErrorIf(d_memory.sizeOf(lhs) != 1 || d_memory.sizeOf(rhs) != 1,
+                    "Arguments to ", name, " must be integers.");
 }
 
 int Compiler::randomCell()
@@ -1027,7 +2714,7 @@ int Compiler::randomCell()
     }
     
     int const addr = allocateTemp();
-    d_codeBuffer << d_bfGen.random(addr);
+    emit(d_bfGen.random(addr));
     d_memory.setValueUnknown(addr);
     return addr;
 }
@@ -1037,7 +2724,7 @@ int Compiler::preIncrement(AddressOrInstruction const &target)
     compilerErrorIf(target < 0, "Cannot increment void-expression.");
     
     auto bf   = [&, this](){
-                    d_codeBuffer << d_bfGen.incr(target);
+                    emit(d_bfGen.incr(target));
                 };
     auto func = [](int x){ return ++x; };
     
@@ -1050,8 +2737,8 @@ int Compiler::postIncrement(AddressOrInstruction const &target)
 
     int const tmp = allocateTemp();
     auto bf   = [&, this](){
-                    d_codeBuffer << d_bfGen.assign(tmp, target)
-                                 << d_bfGen.incr(target);
+                    emit(d_bfGen.assign(tmp, target));
+                    emit(d_bfGen.incr(target));
                 };
     auto func = [](int &x){ return x++; };
 
@@ -1063,7 +2750,7 @@ int Compiler::preDecrement(AddressOrInstruction const &target)
     compilerErrorIf(target < 0, "Cannot decrement void-expression.");
 
     auto bf   = [&, this](){
-                    d_codeBuffer << d_bfGen.decr(target);
+                    emit(d_bfGen.decr(target));
                 };
     auto func = [](int x){ return --x; };
     
@@ -1077,8 +2764,8 @@ int Compiler::postDecrement(AddressOrInstruction const &target)
 
     int const tmp = allocateTemp();
     auto bf   = [&, this](){
-                    d_codeBuffer << d_bfGen.assign(tmp, target)
-                                 << d_bfGen.incr(target);
+                    emit(d_bfGen.assign(tmp, target));
+                    emit(d_bfGen.decr(target));
                 };
     auto func = [](int &x){ return x--; };
 
@@ -1090,7 +2777,7 @@ int Compiler::addTo(AddressOrInstruction const &lhs, AddressOrInstruction const
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in addition.");
 
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.addTo(lhs, rhs);
+                   emit(d_bfGen.addTo(lhs, rhs));
                };
 
     auto func = [](int x, int y){
@@ -1104,17 +2791,21 @@ int Compiler::add(AddressOrInstruction const &lhs, AddressOrInstruction const &r
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in addition.");
 
+    int const reused = reuseValue("+", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs));
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.assign(ret, lhs)
-                                << d_bfGen.addTo(ret, rhs);
+                   emit(d_bfGen.assign(ret, lhs));
+                   emit(d_bfGen.addTo(ret, rhs));
                };
 
     auto func = [](int x, int y){
                     return x + y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("+", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs), eval<0b00>(bf, func, ret, lhs, rhs));
 }
 
 int Compiler::subtractFrom(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
@@ -1122,7 +2813,7 @@ int Compiler::subtractFrom(AddressOrInstruction const &lhs, AddressOrInstruction
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in subtraction.");
 
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.subtractFrom(lhs, rhs);
+                   emit(d_bfGen.subtractFrom(lhs, rhs));
                };
 
     auto func = [](int x, int y){
@@ -1137,17 +2828,21 @@ int Compiler::subtract(AddressOrInstruction const &lhs, AddressOrInstruction con
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in subtraction.");
 
+    int const reused = reuseValue("-", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.assign(ret, lhs)
-                                << d_bfGen.subtractFrom(ret, rhs);
+                   emit(d_bfGen.assign(ret, lhs));
+                   emit(d_bfGen.subtractFrom(ret, rhs));
                };
 
     auto func = [](int x, int y){
                     return x - y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("-", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
     
 }
 
@@ -1155,7 +2850,7 @@ int Compiler::multiplyBy(AddressOrInstruction const &lhs, AddressOrInstruction c
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in multiplication.");
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.multiplyBy(lhs, rhs);
+                   emit(d_bfGen.multiplyBy(lhs, rhs));
                };
 
     auto func = [](int x, int y){
@@ -1170,16 +2865,20 @@ int Compiler::multiply(AddressOrInstruction const &lhs, AddressOrInstruction con
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in multiplication.");
 
+    int const reused = reuseValue("*", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs));
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.multiply(lhs, rhs, ret);
+                   emit(d_bfGen.multiply(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
                     return x * y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("*", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs), eval<0b00>(bf, func, ret, lhs, rhs));
     
 }
 
@@ -1187,16 +2886,20 @@ int Compiler::power(AddressOrInstruction const &lhs, AddressOrInstruction const
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in division.");
 
+    int const reused = reuseValue("**", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf = [&, this](){
-                  d_codeBuffer << d_bfGen.power(lhs, rhs, ret);
+                  emit(d_bfGen.power(lhs, rhs, ret));
               };
 
     auto func = [](int x, int y){
                     return std::pow(x, y);
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("**", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
 }
 
 int Compiler::powerBy(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
@@ -1204,7 +2907,7 @@ int Compiler::powerBy(AddressOrInstruction const &lhs, AddressOrInstruction cons
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in division.");
 
     auto bf = [&, this](){
-                  d_codeBuffer << d_bfGen.powerBy(lhs, rhs);
+                  emit(d_bfGen.powerBy(lhs, rhs));
               };
 
     auto func = [](int x, int y){
@@ -1219,17 +2922,26 @@ int Compiler::divide(AddressOrInstruction const &lhs, AddressOrInstruction const
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in division.");
 
+    int const reused = reuseValue("/", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
                    int const dummy = allocateTemp();
                    divModPair(lhs, rhs, ret, dummy);
+
+                   DataFlow::Range const num = d_dataFlow.bounds(lhs);
+                   DataFlow::Range const denom = d_dataFlow.bounds(rhs);
+                   if (denom.lo > 0)
+                       d_dataFlow.assume(ret, {num.lo / denom.hi, num.hi / denom.lo});
                };
 
     auto func = [](int x, int y){
                     return x / y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("/", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
 }
 
 int Compiler::divideBy(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
@@ -1255,17 +2967,26 @@ int Compiler::modulo(AddressOrInstruction const &lhs, AddressOrInstruction const
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in modulo-operation.");
 
+    int const reused = reuseValue("%", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
                    int const dummy = allocateTemp();
                    divModPair(lhs, rhs, dummy, ret);
+
+                   DataFlow::Range const num = d_dataFlow.bounds(lhs);
+                   DataFlow::Range const denom = d_dataFlow.bounds(rhs);
+                   if (denom.lo > 0)
+                       d_dataFlow.assume(ret, {0, std::min(num.hi, denom.hi - 1)});
                };
 
     auto func = [](int x, int y){
                     return x % y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("%", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
 }
 
 int Compiler::moduloBy(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
@@ -1331,7 +3052,7 @@ int Compiler::modDiv(AddressOrInstruction const &lhs, AddressOrInstruction const
 
 void Compiler::divModPair(AddressOrInstruction const &num, AddressOrInstruction const &denom, int const divResult, int const modResult)
 {
-    d_codeBuffer << d_bfGen.divmod(num, denom, divResult, modResult);
+    emit(d_bfGen.divmod(num, denom, divResult, modResult));
     d_memory.setValueUnknown(divResult);
     d_memory.setValueUnknown(modResult);
 }
@@ -1341,16 +3062,20 @@ int Compiler::equal(AddressOrInstruction const &lhs, AddressOrInstruction const
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in comparison.");
 
+    int const reused = reuseValue("==", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs));
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.equal(lhs, rhs, ret);
+                   emit(d_bfGen.equal(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
                     return x == y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("==", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs), eval<0b00>(bf, func, ret, lhs, rhs));
     
 }
 
@@ -1358,16 +3083,20 @@ int Compiler::notEqual(AddressOrInstruction const &lhs, AddressOrInstruction con
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in comparison.");
 
+    int const reused = reuseValue("!=", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs));
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.notEqual(lhs, rhs, ret);
+                   emit(d_bfGen.notEqual(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
                     return x != y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("!=", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs), eval<0b00>(bf, func, ret, lhs, rhs));
     
 }
 
@@ -1375,16 +3104,20 @@ int Compiler::less(AddressOrInstruction const &lhs, AddressOrInstruction const &
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in comparison.");
 
+    int const reused = reuseValue("<", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.less(lhs, rhs, ret);
+                   emit(d_bfGen.less(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
                     return x < y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("<", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
     
 }
 
@@ -1392,16 +3125,20 @@ int Compiler::greater(AddressOrInstruction const &lhs, AddressOrInstruction cons
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in comparison.");
 
+    int const reused = reuseValue(">", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.greater(lhs, rhs, ret);
+                   emit(d_bfGen.greater(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
                     return x > y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue(">", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
     
 }
 
@@ -1409,32 +3146,40 @@ int Compiler::lessOrEqual(AddressOrInstruction const &lhs, AddressOrInstruction
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in comparison.");
 
+    int const reused = reuseValue("<=", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.lessOrEqual(lhs, rhs, ret);
+                   emit(d_bfGen.lessOrEqual(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
                     return x <= y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue("<=", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
 }
 
 int Compiler::greaterOrEqual(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
 {
     compilerErrorIf(lhs < 0 || rhs < 0, "Use of void-expression in comparison.");
 
+    int const reused = reuseValue(">=", lhs, rhs);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.greaterOrEqual(lhs, rhs, ret);
+                   emit(d_bfGen.greaterOrEqual(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
                     return x >= y;
                 };
 
-    return eval<0b00>(bf, func, ret, lhs, rhs);
+    return recordValue(">=", lhs, rhs, eval<0b00>(bf, func, ret, lhs, rhs));
     
 }
 
@@ -1442,16 +3187,20 @@ int Compiler::logicalNot(AddressOrInstruction const &arg)
 {
     compilerErrorIf(arg < 0, "Use of void-expression in not-operation.");
 
+    int const reused = reuseValue("!", arg);
+    if (reused != -1)
+        return reused;
+
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.logicalNot(arg, ret);
+                   emit(d_bfGen.logicalNot(arg, ret));
                };
 
     auto func = [](int x){
                     return !x;
                 };
 
-    return eval<0b0>(bf, func, ret, arg);
+    return recordValue("!", arg, -1, eval<0b0>(bf, func, ret, arg));
 }
 
 int Compiler::logicalAnd(AddressOrInstruction const &lhs, AddressOrInstruction const &rhs)
@@ -1461,7 +3210,7 @@ int Compiler::logicalAnd(AddressOrInstruction const &lhs, AddressOrInstruction c
     
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.logicalAnd(lhs, rhs, ret);
+                   emit(d_bfGen.logicalAnd(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
@@ -1473,7 +3222,9 @@ int Compiler::logicalAnd(AddressOrInstruction const &lhs, AddressOrInstruction c
     // warning by disabling this check.
 
     disableBoundChecking();
-    int const result = eval<0b00>(bf, func, ret, lhs, rhs);
+    int const reused = reuseValue("&&", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs));
+    int const result = (reused != -1) ? reused :
+        recordValue("&&", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs), eval<0b00>(bf, func, ret, lhs, rhs));
     enableBoundChecking();
     return result;
 }
@@ -1485,7 +3236,7 @@ int Compiler::logicalOr(AddressOrInstruction const &lhs, AddressOrInstruction co
 
     int const ret = allocateTemp();
     auto bf  = [&, this](){
-                   d_codeBuffer << d_bfGen.logicalOr(lhs, rhs, ret);
+                   emit(d_bfGen.logicalOr(lhs, rhs, ret));
                };
 
     auto func = [](int x, int y){
@@ -1497,7 +3248,9 @@ int Compiler::logicalOr(AddressOrInstruction const &lhs, AddressOrInstruction co
     // warning by disabling this check.
     
     disableBoundChecking(); 
-    int const result = eval<0b00>(bf, func, ret, lhs, rhs);
+    int const reused = reuseValue("||", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs));
+    int const result = (reused != -1) ? reused :
+        recordValue("||", std::min<int>(lhs, rhs), std::max<int>(lhs, rhs), eval<0b00>(bf, func, ret, lhs, rhs));
     enableBoundChecking();
     return result;
 }
@@ -1529,6 +3282,8 @@ void Compiler::exitScope(std::string const &name)
     {
         auto const &[outOfScopeString, outOfScopeType] = d_scope.pop();
         d_memory.freeLocals(outOfScopeString);
+        d_liveness.release(outOfScopeString);
+        d_layout.release(outOfScopeString);
 
         if (d_bcrEnabled)
         {
@@ -1563,6 +3318,8 @@ void Compiler::allocateBCRFlags(bool const alloc)
     {
         breakFlag = allocate("__break_flag", TypeSystem::Type(1));
         continueFlag = allocate("__continue_flag", TypeSystem::Type(1));
+        d_clearedFlags.erase(breakFlag);
+        d_clearedFlags.erase(continueFlag);
         
         if (d_constEvalEnabled)
         {
@@ -1620,7 +3377,7 @@ int Compiler::ifStatement(Instruction const &condition, Instruction const &ifBod
     int const conditionAddr = condition();
     compilerErrorIf(conditionAddr < 0, "Use of void-expression in if-condition.");
 
-    if (d_constEvalEnabled && d_memory.valueKnown(conditionAddr))
+    if (d_constEvalEnabled && valueKnown(conditionAddr))
     {
         if (scoped)
             enterScope(Scope::Type::If);
@@ -1634,6 +3391,7 @@ int Compiler::ifStatement(Instruction const &condition, Instruction const &ifBod
     }
 
     // Runtime evaluation
+    Facts const facts = conditionFacts(conditionAddr);
     disableConstEval();
     
     int const ifFlag = allocateTemp();
@@ -1641,8 +3399,7 @@ int Compiler::ifStatement(Instruction const &condition, Instruction const &ifBod
     int const elseFlag = logicalNot(ifFlag);
 
 
-    d_codeBuffer << d_bfGen.movePtr(ifFlag)
-                 << "[";
+    beginRuntimeBlock(ifFlag, DataFlow::Block::ONCE, facts);
 
     {
         if (scoped)
@@ -1654,10 +3411,9 @@ int Compiler::ifStatement(Instruction const &condition, Instruction const &ifBod
             exitScope();
     }
     
-    d_codeBuffer << d_bfGen.setToValue(ifFlag, 0)
-                 << "]"
-                 << d_bfGen.movePtr(elseFlag)
-                 << "[";
+    emit(d_bfGen.setToValue(ifFlag, 0));
+    endRuntimeBlock(ifFlag);
+    beginRuntimeBlock(elseFlag, DataFlow::Block::ONCE);
 
     {
         if (scoped)
@@ -1669,44 +3425,54 @@ int Compiler::ifStatement(Instruction const &condition, Instruction const &ifBod
             exitScope();
     }
     
-    d_codeBuffer << d_bfGen.setToValue(elseFlag, 0)
-                 << "]";
+    emit(d_bfGen.setToValue(elseFlag, 0));
+    endRuntimeBlock(elseFlag);
 
 
-    if (d_bcrEnabled)
+    // If/else might have changed bcr-flags --> mark values unknown
+    forgetBcrFlags();
+    enableConstEval();
+    
+    return -1;
+}
+
+void Compiler::forgetBcrFlags()
+{
+    if (!d_bcrEnabled)
+        return;
+    
+    d_memory.setValueUnknown(getCurrentContinueFlag());
+    for (auto const &pr: d_bcrMap)
     {
-        // If/else might have changed bcr-flags --> mark values unknown
-        d_memory.setValueUnknown(getCurrentContinueFlag());
-        for (auto const &pr: d_bcrMap)
+        if (pr.first.find(d_scope.function()) == 0)
         {
-            if (pr.first.find(d_scope.function()) == 0)
-            {
-                int const breakFlag = pr.second.first;
-                d_memory.setValueUnknown(breakFlag);
-            }
+            int const breakFlag = pr.second.first;
+            d_memory.setValueUnknown(breakFlag);
         }
     }
-
-    enableConstEval();
-    
-    return -1;
 }
 
 int Compiler::forStatement(Instruction const &init, Instruction const &condition,
                            Instruction const &increment, Instruction const &body)
 {
+    auto const runtime = [&, this](int const factor){
+                             return forStatementRuntimeImpl(init, condition, increment, body, factor);
+                         };
+    
     if (!d_constEvalEnabled)
-        return forStatementRuntime(init, condition, increment, body);
+        return runtime(1);
 
+    std::string const location = filename() + ":" + std::to_string(lineNr());
     State state = save();
     enterScope(Scope::Type::For);
     init();
     int conditionAddr = condition();
     
-    if (!d_memory.valueKnown(conditionAddr))
+    if (!valueKnown(conditionAddr))
     {
         restore(std::move(state));
-        return forStatementRuntime(init, condition, increment, body);
+        ++d_unrollReport[location + ": condition unknown -> runtime"];
+        return runtime(1);
     }
 
     int count = 0;
@@ -1715,26 +3481,37 @@ int Compiler::forStatement(Instruction const &init, Instruction const &condition
         body();
         resetContinueFlag();
         increment();
-        conditionAddr = d_bcrEnabled ? logicalAnd(condition, getCurrentBreakFlag()) : condition();
+        conditionAddr = loopCondition(condition);
         ++d_loopUnrolling;
 
-        if (!d_memory.valueKnown(conditionAddr) || ++count > MAX_LOOP_UNROLL_ITERATIONS)
+        if (!valueKnown(conditionAddr) || ++count > MAX_LOOP_UNROLL_ITERATIONS)
         {
             restore(std::move(state));
-            return forStatementRuntime(init, condition, increment, body);
+            ++d_unrollReport[location + ": trip count unknown or above limit -> runtime"];
+            return runtime(1);
         }
 
     }    
 
-    --d_loopUnrolling;
+    d_loopUnrolling = state.loopUnrolling;
     exitScope();
     
-    return -1;
+    return selectUnrolling(std::move(state), location, count, runtime);
 }
 
 int Compiler::forStatementRuntime(Instruction const &init, Instruction const &condition,
                                   Instruction const &increment, Instruction const &body)
 {
+    return forStatementRuntimeImpl(init, condition, increment, body, 1);
+}
+
+int Compiler::forStatementRuntimeImpl(Instruction const &init, Instruction const &condition,
+                                      Instruction const &increment, Instruction const &body, int const factor)
+{
+    // When the number of iterations is known to be a multiple of factor, the body
+    // is repeated factor times for every evaluation of the condition.
+    
+    long const start = d_codeBuffer.size();
     int const flag = allocateTemp();
     enterScope(Scope::Type::For);
     disableConstEval();
@@ -1743,19 +3520,39 @@ int Compiler::forStatementRuntime(Instruction const &init, Instruction const &co
     int conditionAddr = condition();
     compilerErrorIf(conditionAddr < 0, "Use of void-expression in for-condition.");
 
-    d_codeBuffer << d_bfGen.assign(flag, conditionAddr);
-    d_codeBuffer << "[";
+    // The condition is evaluated in the same way at the end of every iteration,
+    // so what it implies holds at the start of each of them.
+    Facts const facts = conditionFacts(conditionAddr);
+    emit(d_bfGen.assign(flag, conditionAddr));
+    beginRuntimeBlock(flag, DataFlow::Block::LOOP, facts);
 
-    body();
-    resetContinueFlag();
-    increment();
-    conditionAddr = d_bcrEnabled ? logicalAnd(condition, getCurrentBreakFlag()) : condition();
+    long const bodyBegin = d_codeBuffer.size();
+    int const loopUnrolling = d_loopUnrolling;
+    for (int i = 0; i != factor; ++i)
+    {
+        body();
+        resetContinueFlag();
+        increment();
+        ++d_loopUnrolling;
+    }
+    d_loopUnrolling = loopUnrolling;
+    
+    long const bodyEnd = d_codeBuffer.size();
+    conditionAddr = loopCondition(condition);
                                
-    d_codeBuffer << d_bfGen.assign(flag, conditionAddr)
-                 << "]";
+    emit(d_bfGen.assign(flag, conditionAddr));
+    endRuntimeBlock(flag);
 
     exitScope();
     enableConstEval();
+
+    long const end = d_codeBuffer.size();
+    d_loopCost = {
+                  .setup     = bodyBegin - start,
+                  .body      = (bodyEnd - bodyBegin) / factor,
+                  .condition = std::max(end - bodyEnd, 0L)
+    };
+    
     return -1;
 }
 
@@ -1778,10 +3575,11 @@ int Compiler::forRangeStatement(BFXFunction::Parameter const &param, Instruction
         for (int i = 0; i != nIter; ++i)
         {
             d_memory.addAlias(arrayAddr + i, ident, d_scope.current());
+            d_liveness.pin(arrayAddr + i);
             body();
             d_memory.removeAlias(arrayAddr + i, ident, d_scope.current());
             resetContinueFlag();
-            d_loopUnrolling = true;
+            ++d_loopUnrolling;
         }    
     }
     else
@@ -1789,6 +3587,8 @@ int Compiler::forRangeStatement(BFXFunction::Parameter const &param, Instruction
         int const elementAddr = declareVariable(ident, TypeSystem::Type(1));
         for (int i = 0; i != nIter; ++i)
         {
+            d_liveness.use(arrayAddr);
+            d_liveness.use(elementAddr);
             assign(elementAddr, arrayAddr + i);
             body();
             resetContinueFlag();
@@ -1796,7 +3596,7 @@ int Compiler::forRangeStatement(BFXFunction::Parameter const &param, Instruction
         }    
     }
     
-    --d_loopUnrolling;
+    d_loopUnrolling = state.loopUnrolling;
     exitScope();
     
     return -1;
@@ -1822,20 +3622,22 @@ int Compiler::forRangeStatementRuntime(BFXFunction::Parameter const &param, Inst
     int const elementAddr = declareVariable(ident, TypeSystem::Type(1));
     compilerErrorIf(elementAddr < 0 || arrayAddr < 0, "Use of void-expression in for-initialization.");
 
-    d_codeBuffer << d_bfGen.setToValue(iterator, 0)
-                 << d_bfGen.setToValue(finalIdx, nIter)
-                 << d_bfGen.setToValue(flag, 1)
-                 << "["
-                 <<    d_bfGen.fetchElement(arrayAddr, nIter, iterator, elementAddr);
+    emit(d_bfGen.setToValue(iterator, 0));
+    emit(d_bfGen.setToValue(finalIdx, nIter - 1));
+    emit(d_bfGen.setToValue(flag, 1));
+    beginRuntimeBlock(flag, DataFlow::Block::LOOP);
+    emit(d_bfGen.fetchElement(arrayAddr, nIter, iterator, elementAddr));
 
     body();
     resetContinueFlag();
     int finalElementCheck = notEqual(iterator, finalIdx);
-    int conditionAddr = d_bcrEnabled ? logicalAnd(finalElementCheck, getCurrentBreakFlag()) : finalElementCheck;
+    int conditionAddr = loopCondition(finalElementCheck);
     
-    d_codeBuffer <<    d_bfGen.incr(iterator)
-                 <<    d_bfGen.assign(flag, conditionAddr)
-                 << "]";
+    emit(d_bfGen.incr(iterator));
+    emit(d_bfGen.assign(flag, conditionAddr));
+    d_liveness.use(arrayAddr);
+    d_liveness.use(elementAddr);
+    endRuntimeBlock(flag);
     
     exitScope();
     enableConstEval();
@@ -1844,17 +3646,23 @@ int Compiler::forRangeStatementRuntime(BFXFunction::Parameter const &param, Inst
 
 int Compiler::whileStatement(Instruction const &condition, Instruction const &body)
 {
+    auto const runtime = [&, this](int const factor){
+                             return whileStatementRuntimeImpl(condition, body, factor);
+                         };
+
     if (!d_constEvalEnabled)
-        return whileStatementRuntime(condition, body);
+        return runtime(1);
 
+    std::string const location = filename() + ":" + std::to_string(lineNr());
     State state = save();
     enterScope(Scope::Type::While);
     
     int conditionAddr = condition();
-    if (!d_memory.valueKnown(conditionAddr))
+    if (!valueKnown(conditionAddr))
     {
         restore(std::move(state));
-        return whileStatementRuntime(condition, body);
+        ++d_unrollReport[location + ": condition unknown -> runtime"];
+        return runtime(1);
     }
 
     int count = 0;
@@ -1862,46 +3670,290 @@ int Compiler::whileStatement(Instruction const &condition, Instruction const &bo
     {
         body();
         resetContinueFlag();
-        conditionAddr = d_bcrEnabled ? logicalAnd(condition, getCurrentBreakFlag()) : condition();
+        conditionAddr = loopCondition(condition);
         ++d_loopUnrolling;
         
-        if (!d_memory.valueKnown(conditionAddr) || (count++ > MAX_LOOP_UNROLL_ITERATIONS))
+        if (!valueKnown(conditionAddr) || (count++ > MAX_LOOP_UNROLL_ITERATIONS))
         {
             restore(std::move(state));
-            return whileStatementRuntime(condition, body);
+            ++d_unrollReport[location + ": trip count unknown or above limit -> runtime"];
+            return runtime(1);
         }
     }
     
-    --d_loopUnrolling;
+    d_loopUnrolling = state.loopUnrolling;
     exitScope();
-    return -1;    
+    return selectUnrolling(std::move(state), location, count, runtime);
 }
 
 int Compiler::whileStatementRuntime(Instruction const &condition, Instruction const &body)
 {
-    int const flag = condition();
-    compilerErrorIf(flag < 0, "Use of void-expression in while-condition.");
+    return whileStatementRuntimeImpl(condition, body, 1);
+}
+
+int Compiler::whileStatementRuntimeImpl(Instruction const &condition, Instruction const &body, int const factor)
+{
+    // The flag is updated at the end of every iteration, so a variable that is
+    // used as condition has to be copied.
+
+    long const start = d_codeBuffer.size();
+    bool const runtime = !d_constEvalEnabled;
+    int const conditionAddr = condition();
+    compilerErrorIf(conditionAddr < 0, "Use of void-expression in while-condition.");
+
+    // Only when the condition is evaluated at runtime here, it is computed in the
+    // same way as at the end of every iteration.
+    Facts const facts = runtime ? conditionFacts(conditionAddr) : Facts{};
+    int const flag = d_memory.isTemp(conditionAddr) ? conditionAddr : assign(allocateTemp(), conditionAddr);
 
     enterScope(Scope::Type::While);
     disableConstEval();
     
-    d_codeBuffer << d_bfGen.movePtr(flag)
-                 << "[";
-    body();
-    resetContinueFlag();
-    int conditionAddr = d_bcrEnabled ? logicalAnd(condition, getCurrentBreakFlag()) : condition();
-    
-    d_codeBuffer << d_bfGen.assign(flag, conditionAddr)
-                 << "]";
+    beginRuntimeBlock(flag, DataFlow::Block::LOOP, facts);
+
+    long const bodyBegin = d_codeBuffer.size();
+    int const loopUnrolling = d_loopUnrolling;
+    for (int i = 0; i != factor; ++i)
+    {
+        body();
+        resetContinueFlag();
+        ++d_loopUnrolling;
+    }
+    d_loopUnrolling = loopUnrolling;
+
+    long const bodyEnd = d_codeBuffer.size();
+    emit(d_bfGen.assign(flag, loopCondition(condition)));
+    endRuntimeBlock(flag);
 
     exitScope();
     enableConstEval();
+
+    long const end = d_codeBuffer.size();
+    d_loopCost = {
+                  .setup     = bodyBegin - start,
+                  .body      = (bodyEnd - bodyBegin) / factor,
+                  .condition = std::max(end - bodyEnd, 0L)
+    };
+
+    return -1;
+}
+
+int Compiler::selectUnrolling(State &&before, std::string const &location, int const iterations,
+                              std::function<int(int)> const &runtime)
+{
+    // The loop has been unrolled completely. Unless optimizing for speed, it is
+    // compared to the runtime loop, which can also repeat its body a number of
+    // times (a divisor of the number of iterations) for every evaluation of its
+    // condition. The alternative with the lowest estimated cost is kept.
+
+    long const unrolledSize = (long)d_codeBuffer.size() - (long)before.buffer.size();
+    Estimate const unrolled{unrolledSize, unrolledSize * loopWeight()};
+    std::string const entry = location + ": " + std::to_string(iterations) + " iterations, unrolled (" +
+        std::to_string(unrolled.size) + " ops, " + std::to_string(unrolled.steps) + " steps)";
+    
+    if (iterations < 2 || d_optimizeFor == OptimizeFor::SPEED)
+    {
+        ++d_unrollReport[entry + " -> unrolled"];
+        return -1;
+    }
+
+    State result = save();
+    restore(State{before});
+    runtime(1);
+    LoopCost const cost = d_loopCost;
+
+    int factor = 1;
+    Estimate best = estimate(cost, iterations, 1);
+    for (int f = 2; f <= std::min(MAX_UNROLL_FACTOR, iterations / 2); ++f)
+    {
+        Estimate const e = estimate(cost, iterations, f);
+        if (iterations % f == 0 && cheaper(e, best))
+        {
+            factor = f;
+            best = e;
+        }
+    }
+
+    // The sizes change when the code is generated again (e.g. with other cell
+    // addresses), so later passes replay the decisions of the first.
+    int choice = cheaper(best, unrolled) ? factor : 0;
+    if (!d_unrollReplay)
+        d_unrollDecisions.push_back(choice);
+    else if (d_unrollDecision < d_unrollDecisions.size())
+    {
+        // A replayed factor must still divide the trip count; if this pass sees
+        // another count, fall back to a plain runtime loop.
+        choice = d_unrollDecisions[d_unrollDecision++];
+        if (choice > 1 && iterations % choice != 0)
+            choice = 1;
+    }
+
+    std::string const report = entry + ", runtime x" + std::to_string(factor) + " (" +
+        std::to_string(best.size) + " ops, " + std::to_string(best.steps) + " steps) -> ";
+
+    if (choice == 0)
+    {
+        restore(std::move(result));
+        ++d_unrollReport[report + "unrolled"];
+        return -1;
+    }
+
+    if (choice != 1)
+    {
+        restore(std::move(before));
+        runtime(choice);
+    }
+
+    ++d_unrollReport[report + "runtime x" + std::to_string(choice)];
     return -1;
 }
 
+Compiler::Estimate Compiler::estimate(LoopCost const &cost, int const iterations, int const factor) const
+{
+    return {
+            .size  = cost.setup + factor * cost.body + cost.condition,
+            .steps = (cost.setup + iterations * cost.body + (iterations / factor) * cost.condition) * loopWeight()
+    };
+}
+
+bool Compiler::cheaper(Estimate const &e1, Estimate const &e2) const
+{
+    switch (d_optimizeFor)
+    {
+    case OptimizeFor::SIZE:  return std::tie(e1.size, e1.steps) < std::tie(e2.size, e2.steps);
+    case OptimizeFor::SPEED: return std::tie(e1.steps, e1.size) < std::tie(e2.steps, e2.size);
+    default:                 return e1.size + e1.steps < e2.size + e2.steps;
+    }
+}
+
+long Compiler::loopWeight() const
+{
+    // Code inside a runtime loop is executed more than once; use the same weight
+    // per level of nesting as the cell layout.
+    return 1L << (3 * std::min(d_loopDepth, 10));
+}
+
 int Compiler::switchStatement(Instruction const &compareExpr,
                               std::vector<std::pair<Instruction, Instruction>> const &cases,
                               Instruction const &defaultCase)
+{
+    // When all case-labels are constants, the selector is evaluated once and the
+    // matching case is found by counting down through the sorted labels. Otherwise,
+    // the switch is lowered to an if-else ladder.
+    
+    SwitchArms const arms = switchArms(cases);
+    if (arms.empty())
+        return switchLadder(compareExpr, cases, defaultCase);
+
+    int const selector = compareExpr();
+    compilerErrorIf(selector < 0, "Use of void-expression in switch-statement.");
+
+    if (d_constEvalEnabled && valueKnown(selector))
+    {
+        int const value = d_memory.value(selector);
+        auto const match = std::find_if(arms.begin(), arms.end(),
+                                        [&](auto const &arm){
+                                            return arm.first == value;
+                                        });
+        enterScope(Scope::Type::If);
+        (match != arms.end() ? *match->second : defaultCase)();
+        exitScope();
+        
+        return -1;
+    }
+
+    return switchRuntime(selector, arms, defaultCase);
+}
+
+Compiler::SwitchArms Compiler::switchArms(std::vector<std::pair<Instruction, Instruction>> const &cases)
+{
+    // The labels are evaluated speculatively; the results are only used when all of
+    // them are constants.
+    
+    State state = save();
+    SwitchArms arms;
+    std::set<int> values;
+    bool constant = true;
+    for (auto const &[label, body]: cases)
+    {
+        int const addr = label();
+        compilerErrorIf(addr < 0, "Use of void-expression in case-label.");
+
+        constant = isConstant(addr);
+        if (!constant)
+            break;
+
+        int const value = d_memory.value(addr);
+        if (values.insert(value).second)
+            arms.emplace_back(value, &body);
+        else
+            compilerWarning("duplicate case-label ", value, " will never be matched.");
+    }
+    restore(std::move(state));
+    
+    if (!constant)
+        return {};
+
+    std::sort(arms.begin(), arms.end(),
+              [](auto const &arm1, auto const &arm2){
+                  return arm1.first < arm2.first;
+              });
+    return arms;
+}
+
+int Compiler::switchRuntime(int const selector, SwitchArms const &arms, Instruction const &defaultCase)
+{
+    // A copy of the selector is decremented towards the next label at every level,
+    // descending into the next level only while it is still nonzero. On the way back
+    // up, the flag selects the body of the deepest level that was reached: the
+    // matching case, or the default when the selector exceeds all labels.
+    
+    disableConstEval();
+
+    int const value = allocateTemp();
+    assign(value, selector);
+    int const flag = allocateTemp();
+    emit(d_bfGen.setToValue(flag, 1));
+    d_memory.setValueUnknown(flag);
+
+    auto const arm = [&, this](Instruction const &body)
+                     {
+                         beginRuntimeBlock(flag, DataFlow::Block::ONCE);
+                         enterScope(Scope::Type::If);
+                         body();
+                         exitScope();
+                         emit(d_bfGen.setToValue(flag, 0));
+                         endRuntimeBlock(flag);
+                     };
+
+    std::function<void(size_t const, int const)> level;
+    level = [&, this](size_t const idx, int const previous)
+            {
+                long const mod = MAX_INT + 1;
+                long const diff = arms[idx].first - previous;
+                emit(d_bfGen.addConst(value, (2 * diff > mod) ? (mod - diff) : -diff));
+
+                beginRuntimeBlock(value, DataFlow::Block::ONCE);
+                if (idx + 1 != arms.size())
+                    level(idx + 1, arms[idx].first);
+                else
+                    arm(defaultCase);
+
+                emit(d_bfGen.setToValue(value, 0));
+                endRuntimeBlock(value);
+                arm(*arms[idx].second);
+            };
+
+    level(0, 0);
+    forgetBcrFlags();
+    enableConstEval();
+
+    return -1;
+}
+
+int Compiler::switchLadder(Instruction const &compareExpr,
+                           std::vector<std::pair<Instruction, Instruction>> const &cases,
+                           Instruction const &defaultCase)
 {
     std::function<Instruction(size_t const)> ifElseLadder;
 
@@ -1927,12 +3979,7 @@ int Compiler::breakStatement()
 {
     compilerErrorIf(!d_bcrEnabled, "break-statement not supported when compiling with --no-bcr");
     
-    int const flag = getCurrentBreakFlag();
-    if (d_constEvalEnabled)
-        constEvalSetToValue(flag, 0);
-    else
-        runtimeSetToValue(flag, 0);
-    
+    clearFlag(getCurrentBreakFlag());
     return -1;
 }
 
@@ -1940,12 +3987,7 @@ int Compiler::continueStatement()
 {
     compilerErrorIf(!d_bcrEnabled, "continue-statement not supported when compiling with --no-bcr");
     
-    int const flag = getCurrentContinueFlag();
-    if (d_constEvalEnabled)
-        constEvalSetToValue(flag, 0);
-    else
-        runtimeSetToValue(flag, 0);
-    
+    clearFlag(getCurrentContinueFlag());
     return -1;
 }
 
@@ -1969,50 +4011,102 @@ int Compiler::returnStatement()
     for (auto const &pr: d_bcrMap)
     {
         if (pr.first.find(func) == 0)
-        {
-            int const breakFlag = pr.second.first;
-            if (d_constEvalEnabled)
-                constEvalSetToValue(breakFlag, 0);
-            else
-                runtimeSetToValue(breakFlag, 0);
-        }
+            clearFlag(pr.second.first);
     }
 
     return -1;
 }
 
-std::string Compiler::cancelOppositeCommands(std::string const &bf)
+void Compiler::clearFlag(int const flag)
+{
+    d_clearedFlags.insert(flag);
+    if (d_constEvalEnabled)
+        constEvalSetToValue(flag, 0);
+    else
+        runtimeSetToValue(flag, 0);
+}
+
+int Compiler::loopCondition(AddressOrInstruction const &condition)
+{
+    // The break-flag only needs to be checked when a break or return statement
+    // in the body may have cleared it.
+    if (d_bcrEnabled && d_clearedFlags.find(getCurrentBreakFlag()) != d_clearedFlags.end())
+        return logicalAnd(condition, getCurrentBreakFlag());
+
+    return condition;
+}
+
+std::string Compiler::cancelOppositeCommands(std::string const &bf, std::vector<size_t> *origin)
 {
+    // When origin is given, it receives the position in bf from which each of the
+    // characters of the result originates.
+    
     auto cancel =
-        [](std::string const &input, char const up, char const down) -> std::string
+        [](std::string const &input, std::vector<size_t> &pos, char const up, char const down) -> std::string
         {
             std::string result;
+            std::vector<size_t> resultPos;
+            bool const track = !pos.empty();
             int count = 0;
+            size_t start = 0;
 
             auto flush = [&]()
                          {
                              if (count > 0) result += std::string( count, up);
                              if (count < 0) result += std::string(-count, down);
+                             if (track) resultPos.resize(result.size(), start);
                              count = 0;
                          };
 
     
-            for (char c: input)
+            for (size_t idx = 0; idx != input.size(); ++idx)
             {
-                if (c == up)   ++count;
-                else if (c == down) --count;
+                char const c = input[idx];
+                if (c == up || c == down)
+                {
+                    if (count == 0 && track)
+                        start = pos[idx];
+                    count += (c == up) ? 1 : -1;
+                }
                 else
                 {
                     flush();
                     result += c;
+                    if (track) resultPos.push_back(pos[idx]);
                 }
             }
     
             flush();
+            pos = std::move(resultPos);
             return result;
         };
 
-    return cancel(cancel(bf, '>', '<'), '+', '-');
+    std::vector<size_t> pos;
+    if (origin)
+    {
+        pos.resize(bf.size());
+        std::iota(pos.begin(), pos.end(), 0);
+    }
+
+    std::string const moves = cancel(bf, pos, '>', '<');
+    std::string const result = cancel(moves, pos, '+', '-');
+    if (origin)
+        *origin = std::move(pos);
+
+    return result;
+}
+
+SourceMap::Location Compiler::sourceLocation() const
+{
+    std::string stack;
+    for (std::string const &function: d_scope.functions())
+    {
+        if (!stack.empty())
+            stack += ';';
+        stack += BFXFunction::demangle(function);
+    }
+
+    return {d_instructionFilename, d_instructionLineNr, stack};
 }
 
 void Compiler::setFilename(std::string const &file)
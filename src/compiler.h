@@ -11,11 +11,19 @@
 
 #include <string>
 #include <map>
+#include <set>
+#include <tuple>
 #include <sstream>
 #include "scanner.h"
 #include "bfgenerator.h"
 #include "memory.h"
 #include "scope.h"
+#include "dataflow.h"
+#include "liveness.h"
+#include "layout.h"
+#include "dispatch.h"
+#include "partialeval.h"
+#include "sourcemap.h"
 
 class Compiler: public CompilerBase
 {
@@ -27,6 +35,13 @@ public:
          INT32
         };
 
+    enum class OptimizeFor
+        {
+         BALANCED,
+         SIZE,
+         SPEED
+        };
+
     struct Options
     {
         Compiler::CellType        cellType{Compiler::CellType::INT8};
@@ -34,6 +49,7 @@ public:
         std::string               bfxFile;
         std::string               testFile;;
         std::string               profileFile;
+        std::string               sourceMapFile;
         std::ostream*             outStream{&std::cout};
         bool                      constEvalAllowed{true};
         bool                      randomEnabled{false};
@@ -41,6 +57,14 @@ public:
         bool                      includeWarningEnabled{true};
         bool                      assertWarningEnabled{true};
         int                       maxUnrollIterations{20};
+        OptimizeFor               optimizeFor{OptimizeFor::BALANCED};
+        bool                      memoryReuseEnabled{true};
+        bool                      deadStoreEliminationEnabled{true};
+        bool                      deadStoreWarningEnabled{false};
+        bool                      cellLayoutEnabled{true};
+        std::vector<std::string>  outlined;
+        int                       outlineThreshold{0};
+        long                      partialEvalBudget{0};
     };
 
 private:
@@ -49,6 +73,8 @@ private:
     long const MAX_INT;
     long const MAX_ARRAY_SIZE;
     int  const MAX_LOOP_UNROLL_ITERATIONS{20};
+    static constexpr int MAX_UNROLL_FACTOR{8};
+    static constexpr int MAX_SHARED_BASE{16};
 
     std::string const d_sourceFile;
     CellType const d_cellType;
@@ -57,15 +83,96 @@ private:
     Memory      d_memory;
     Scope       d_scope;
     BFGenerator d_bfGen;
+    DataFlow    d_dataFlow;
+    Liveness    d_liveness;
+    Layout      d_layout;
+    Dispatch    d_dispatch;
+    PartialEval d_partialEval;
+    SourceMap   d_sourceMap;
 
     std::map<std::string, BFXFunction>         d_functionMap;
     std::map<std::string, int>                 d_constMap;
     std::vector<std::string>                   d_includePaths;
     std::vector<std::string>                   d_included;
-    std::ostringstream                         d_codeBuffer;
+    std::string                                d_codeBuffer;
+    std::vector<std::pair<std::string, TypeSystem::Type>> d_globals;
+
+    // Functions that are called out-of-line are generated once for every
+    // combination of argument types (an instance), with a fixed frame.
+    struct Instance
+    {
+        size_t           routine;
+        std::vector<int> params;
+        int              ret{-1};
+        TypeSystem::Type retType;
+    };
+
+    struct Expansion
+    {
+        int    count{0};
+        size_t smallest{0};
+    };
+
+    // Loops that could be unrolled completely are compared to their runtime
+    // equivalent. The sizes of the parts of the last runtime loop that was
+    // generated are used to estimate the cost of each alternative.
+    struct LoopCost
+    {
+        long setup{0};
+        long body{0};
+        long condition{0};
+    };
+
+    struct Estimate
+    {
+        long size;
+        long steps;
+    };
+
+    LoopCost                           d_loopCost;
+    std::map<std::string, int>         d_unrollReport;
+    std::vector<int>                   d_unrollDecisions; // replayed in later passes
+    size_t                             d_unrollDecision{0};
+    bool                               d_unrollReplay{false};
+    
+    // Effects of calls that were evaluated entirely at compiletime
+    struct Memo
+    {
+        std::vector<int> refs;
+        std::vector<int> globals;
+        std::vector<int> ret;
+        TypeSystem::Type retType;
+    };
+
+    std::map<std::string, Memo>        d_memo;
+    size_t                             d_memoHits{0};
+    
+    // Runtime values computed earlier in the current statement, keyed by the
+    // operation and the addresses of its operands. They are reused as long as
+    // none of the cells they were computed from has been written to.
+    struct Value
+    {
+        int                              addr;
+        std::string                      scope;
+        std::vector<std::pair<int, int>> operands; // [begin, end) of each operand
+    };
+
+    using ValueKey = std::tuple<std::string, int, int>;
+    std::map<ValueKey, Value>          d_values;
+    size_t                             d_valuesReused{0};
+    
+    std::set<std::string>              d_outlined;
+    std::map<std::string, Instance>    d_instances;
+    std::map<std::string, Expansion>   d_expansions;
 
     using BcrMapType = std::map<std::string, std::pair<int, int>>;
-    BcrMapType d_bcrMap;
+    BcrMapType    d_bcrMap;
+    std::set<int> d_clearedFlags; // bcr-flags that a break, continue or return may have cleared
+
+    // Variables of which stores were eliminated, per source location
+    using DeadStoreMap = std::map<std::pair<std::string, int>, std::set<std::string>>;
+    DeadStoreMap  d_deadStores;
+    size_t        d_deadStoreCount{0};
     
     enum class Stage
         {
@@ -82,12 +189,24 @@ private:
     bool const    d_constEvalAllowed{true};
     bool const    d_randomExtensionEnabled{false};
     int           d_loopUnrolling{0};
+    int           d_loopDepth{0};
     bool          d_boundsCheckingEnabled{true};
     bool const    d_bcrEnabled{true};
     bool const    d_includeWarningEnabled{true};
     bool const    d_assertWarningEnabled{true};
+    bool const    d_memoryReuseEnabled{true};
+    bool const    d_deadStoreEliminationEnabled{true};
+    bool const    d_deadStoreWarningEnabled{false};
+    bool const    d_cellLayoutEnabled{true};
+    OptimizeFor const d_optimizeFor{OptimizeFor::BALANCED};
+    int const     d_outlineThreshold{0};
+    bool          d_warningsMuted{false};
+    size_t        d_cellsWithoutReuse{0};
+    size_t        d_cellsRelocated{0};
+    double        d_compileTime{0}; // seconds
     std::ostream& d_outStream;
     std::string const d_profileFile;
+    std::string const d_sourceMapFile;
 
     std::string const d_testFile;
     std::vector<std::string> d_testVector;
@@ -98,11 +217,23 @@ private:
         Memory memory;
         Scope  scope;
         BFGenerator bfGen;
+        DataFlow dataFlow;
+        Liveness::Checkpoint liveness;
+        Layout::Checkpoint layout;
+        Dispatch dispatch;
+        std::map<std::string, Instance> instances;
         std::string buffer;
+        SourceMap sourceMap;
         bool constEval;
         int loopUnrolling;
+        int loopDepth;
+        std::map<std::string, int> unrollReport;
         bool boundsChecking;
         BcrMapType bcrMap;
+        std::set<int> clearedFlags;
+        std::map<ValueKey, Value> values;
+        DeadStoreMap deadStores;
+        size_t deadStoreCount;
     };
 
     enum class SubScopeType
@@ -122,7 +253,13 @@ public:
 
 private:
     int parse();
+    void generate();
+    bool generatePass(State const &initial, Liveness const *liveness = nullptr);
+    void selectOutlined(State const &initial);
+    void allocateGlobals();
     void writeProfile() const;
+    void writeSourceMap(std::vector<size_t> const &origin) const;
+    void warnDeadStores() const;
     void pushStream(std::string const &file);
     std::string fileWithoutPath(std::string const &file);
     void addFunction(BFXFunction const &bfxFunc);
@@ -144,6 +281,8 @@ private:
     void enterScope(std::string const &name);
     void exitScope(std::string const &name = "");
     void allocateBCRFlags(bool const alloc);
+    void clearFlag(int const flag);
+    int loopCondition(AddressOrInstruction const &condition);
     int getCurrentContinueFlag() const;
     int getCurrentBreakFlag() const;
     void resetContinueFlag();
@@ -155,19 +294,36 @@ private:
     void disableBoundChecking();
     void enableBoundChecking();
     void sync(int const addr);
+    void sync(int const start, int const n);
     int wrapValue(int val);
     void constEvalSetToValue(int const addr, int const val);
     void runtimeSetToValue(int const addr, int const val);
-    void runtimeAssign(int const lhs, int const rhs);
+    void runtimeSetToValues(int const start, std::vector<int> const &values);
+    Estimate initCost(std::vector<int> const &values, int const base) const;
+    int reuseValue(std::string const &op, int const lhs, int const rhs = -1);
+    int recordValue(std::string const &op, int const lhs, int const rhs, int const result);
+    int valueNumber(int const addr) const;
+    void forgetValues();
+    void forgetValues(int const addr, int const size = 1);
+    void forgetBcrFlags();
+    void runtimeAssign(int const lhs, int const rhs, int const n = 1);
+    bool valueKnown(int const addr);
+    bool isConstant(int const addr);
+    void emit(std::string const &bf);
+    using Facts = std::vector<std::pair<int, DataFlow::Range>>;
+    void beginRuntimeBlock(int const flag, DataFlow::Block const type, Facts const &facts = {});
+    Facts conditionFacts(int const condition) const;
+    void endRuntimeBlock(int const flag);
     
     static bool validateFunction(BFXFunction const &bfxFunc);
-    static std::string cancelOppositeCommands(std::string const &bf);
+    static std::string cancelOppositeCommands(std::string const &bf, std::vector<size_t> *origin = nullptr);
+    SourceMap::Location sourceLocation() const;
     
     // Memory management uitilities
     int allocate(std::string const &ident, TypeSystem::Type type);
     int allocateTemp(TypeSystem::Type type);
-    int allocateTemp(int const sz = 1);
-    int allocateTempBlock(int const sz);
+    int allocateTemp(int const sz = 1, int const hint = -1);
+    int allocateTempBlock(int const sz, int const hint = -1);
     int addressOf(std::string const &ident);
     int staticAssert(Instruction const &check, std::string const &msg);
 
@@ -205,6 +361,14 @@ private:
     int arrayFromString(std::string const &str);
     int anonymousStructObject(std::string const name, std::vector<Instruction> const &values);
     int call(std::string const &functionName, std::vector<Instruction> const &args = {});
+    using Intrinsic = int (Compiler::*)(std::vector<Instruction> const &);
+    static std::map<std::string, std::pair<size_t, Intrinsic>> const &intrinsics();
+    std::vector<int> globalCells();
+    std::string memoKey(BFXFunction const &func, std::vector<int> const &inputs);
+    void memoize(std::string const &key, BFXFunction const &func, std::vector<int> const &inputs, int const ret);
+    int replay(Memo const &memo, BFXFunction const &func, std::vector<int> const &inputs);
+    int callOutOfLine(BFXFunction const &func, std::vector<Instruction> const &args);
+    Instance outline(BFXFunction const &func, std::string const &key, std::vector<int> const &args);
     int declareVariable(std::string const &ident, TypeSystem::Type type);
     int initializeExpression(std::string const &ident, TypeSystem::Type type,
                              AddressOrInstruction const &rhs);
@@ -213,11 +377,40 @@ private:
     int fetchField(std::vector<std::string> const &expr);
     int fetchFieldImpl(std::vector<std::string> const &expr, int const baseAddr, size_t const baseIdx);
     
+    std::pair<int, int> reachableElements(int const arr, int const index) const;
     int fetchElement(AddressOrInstruction const &arr, AddressOrInstruction const &index);
     int assignElement(AddressOrInstruction const &arr, AddressOrInstruction const &index, AddressOrInstruction const &rhs);
     int scanCell();
     int randomCell();
     int printCell(AddressOrInstruction const &target);
+    int printString(std::vector<Instruction> const &args);
+    int printDecimal(std::vector<Instruction> const &args);
+    int toDecimalString(std::vector<Instruction> const &args);
+    bool knownString(int const str, std::vector<int> &values);
+    int stringLength(std::vector<Instruction> const &args);
+    int stringCompare(std::vector<Instruction> const &args);
+    int stringCopy(std::vector<Instruction> const &args);
+    int memorySet(std::vector<Instruction> const &args);
+    int memoryCopy(std::vector<Instruction> const &args);
+    bool knownDigits(int const start, std::vector<long> &digits);
+    int constArray(std::vector<int> const &values);
+    using BigFold = std::function<std::vector<long>(std::vector<long> const &, std::vector<long> const &, long)>;
+    using BigCode = std::function<std::string(int, int, int, int, int)>;
+    int bigArithmetic(std::string const &name, std::vector<Instruction> const &args, bool const scalar,
+                      BigFold const &fold, BigCode const &code);
+    int bigFromInt(std::vector<Instruction> const &args);
+    int bigAdd(std::vector<Instruction> const &args);
+    int bigSubtract(std::vector<Instruction> const &args);
+    int bigMultiply(std::vector<Instruction> const &args);
+    int bigLess(std::vector<Instruction> const &args);
+    int bigEqual(std::vector<Instruction> const &args);
+    int bigPrintDecimal(std::vector<Instruction> const &args);
+    int bitAnd(std::vector<Instruction> const &args);
+    int bitOr(std::vector<Instruction> const &args);
+    int bitXor(std::vector<Instruction> const &args);
+    int shiftLeft(std::vector<Instruction> const &args);
+    int shiftRight(std::vector<Instruction> const &args);
+    void checkBitwiseOperands(std::string const &name, int const lhs, int const rhs);
     int preIncrement(AddressOrInstruction const &addr);
     int preDecrement(AddressOrInstruction const &addr);
     int postIncrement(AddressOrInstruction const &addr);
@@ -253,15 +446,29 @@ private:
                      Instruction const &increment, Instruction const &body);
     int forStatementRuntime(Instruction const &init, Instruction const &condition,
                             Instruction const &increment, Instruction const &body);
+    int forStatementRuntimeImpl(Instruction const &init, Instruction const &condition,
+                                Instruction const &increment, Instruction const &body, int const factor);
     int forRangeStatement(BFXFunction::Parameter const &param, Instruction const &array, Instruction const &body);
     int forRangeStatementRuntime(BFXFunction::Parameter const &param, Instruction const &array, Instruction const &body);
     
     int whileStatement(Instruction const &condition, Instruction const &body);
     int whileStatementRuntime(Instruction const &condition, Instruction const &body);
+    int whileStatementRuntimeImpl(Instruction const &condition, Instruction const &body, int const factor);
+    int selectUnrolling(State &&before, std::string const &location, int const iterations,
+                        std::function<int(int)> const &runtime);
+    Estimate estimate(LoopCost const &cost, int const iterations, int const factor) const;
+    bool cheaper(Estimate const &e1, Estimate const &e2) const;
+    long loopWeight() const;
     
+    using SwitchArms = std::vector<std::pair<int, Instruction const *>>;
     int switchStatement(Instruction const &compareExpr,
                         std::vector<std::pair<Instruction, Instruction>> const &cases,
                         Instruction const &defaultCase);
+    SwitchArms switchArms(std::vector<std::pair<Instruction, Instruction>> const &cases);
+    int switchRuntime(int const selector, SwitchArms const &arms, Instruction const &defaultCase);
+    int switchLadder(Instruction const &compareExpr,
+                     std::vector<std::pair<Instruction, Instruction>> const &cases,
+                     Instruction const &defaultCase);
     int breakStatement();
     int continueStatement();
     int returnStatement();
@@ -313,6 +520,9 @@ private:
 template <typename First, typename ... Rest>
 void Compiler::compilerWarning(First const &first, Rest&& ... rest) const
 {
+    if (d_warningsMuted)
+        return;
+    
     std::cerr << "Warning: in " << filename() << " on line " << lineNr() << ": " << first;
     (std::cerr << ... << rest) << '\n';
 }
@@ -361,11 +571,12 @@ int Compiler::eval(BFGenFunc&& bfFunc, ConstFunc&& constFunc, int const resultAd
             return VolatileMask & (1 << (N - argIdx - 1));
         };
 
-    bool const canBeConstEvaluated = (d_memory.valueKnown(args) && ...);
+    bool const canBeConstEvaluated = (valueKnown(args) && ...);
     if (canBeConstEvaluated && d_constEvalEnabled)
     {
         // Evaluate using constfunc
         constEvalSetToValue(resultAddr, constFunc(d_memory.value(args) ...));
+        forgetValues(resultAddr);
         
         // Application of constFunc may have resulted in side-effects if it accepted
         // reference-parameters. Check Mask for volatile values ->
@@ -373,7 +584,10 @@ int Compiler::eval(BFGenFunc&& bfFunc, ConstFunc&& constFunc, int const resultAd
         
         for (int i = 0; i != N; ++i)
             if (isVolatile(i))
+            {
                 d_memory.setSync(arguments[i], false);
+                forgetValues(arguments[i]);
+            }
     }
     else 
     {
@@ -389,14 +603,30 @@ int Compiler::eval(BFGenFunc&& bfFunc, ConstFunc&& constFunc, int const resultAd
         // addresses may have changed during runtime. The return-address will always be
         // set as unknown.
         d_memory.setValueUnknown(resultAddr);
+        forgetValues(resultAddr);
         for (int i = 0; i != N; ++i)
             if (isVolatile(i))
+            {
                 d_memory.setValueUnknown(arguments[i]);
+                forgetValues(arguments[i]);
+            }
     }
 
     return resultAddr;
 }
 
+inline std::ostream &operator<<(std::ostream &out, Compiler::OptimizeFor policy)
+{
+    switch (policy)
+    {
+    case Compiler::OptimizeFor::BALANCED: return (out << "balanced");
+    case Compiler::OptimizeFor::SIZE: return (out << "size");
+    case Compiler::OptimizeFor::SPEED: return (out << "speed");
+    }
+
+    assert(false && "unreachable");
+}
+
 inline std::ostream &operator<<(std::ostream &out, Compiler::CellType type)
 {
     switch (type)
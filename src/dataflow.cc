@@ -0,0 +1,405 @@
+#include "dataflow.ih"
+
+DataFlow::Range DataFlow::top() const
+{
+    return {0, d_maxValue};
+}
+
+DataFlow::Range DataFlow::nonZero(Range const &r) const
+{
+    return (r.hi > 0) ? Range{std::max(r.lo, 1L), r.hi} : r;
+}
+
+DataFlow::Range DataFlow::add(Range const &r, Range const &amount) const
+{
+    long const mod = d_maxValue + 1;
+    long lo = r.lo + amount.lo;
+    long hi = r.hi + amount.hi;
+    if (hi - lo > d_maxValue)
+        return top();
+
+    // Shift the range back into [0, max] and check if it wrapped around partially
+    long const shift = ((lo % mod) + mod) % mod - lo;
+    lo += shift;
+    hi += shift;
+    return (hi <= d_maxValue) ? Range{lo, hi} : top();
+}
+
+DataFlow::Range DataFlow::join(Range const &r1, Range const &r2)
+{
+    return {std::min(r1.lo, r2.lo), std::max(r1.hi, r2.hi)};
+}
+
+DataFlow::Range DataFlow::range(int const addr) const
+{
+    assert(addr >= 0 && "negative address");
+    return (addr < (int)d_tape.cells.size()) ? d_tape.cells[addr] : d_tape.beyond;
+}
+
+DataFlow::Range DataFlow::bounds(int const addr) const
+{
+    return d_enabled ? range(addr) : top();
+}
+
+bool DataFlow::known(int const addr) const
+{
+    return d_enabled && range(addr).known();
+}
+
+long DataFlow::value(int const addr) const
+{
+    assert(known(addr) && "requesting value of cell with unknown contents");
+    return range(addr).lo;
+}
+
+void DataFlow::set(int const addr, Range const &r)
+{
+    assert(addr >= 0 && "negative address");
+    if (addr >= (int)d_tape.cells.size())
+        d_tape.cells.resize(addr + 1, d_tape.beyond);
+
+    d_tape.cells[addr] = r;
+}
+
+void DataFlow::assume(int const addr, Range const &r)
+{
+    // The caller has proven that the cell is within r at this point
+    if (!d_enabled)
+        return;
+
+    Range const current = range(addr);
+    Range const narrowed{std::max(current.lo, r.lo), std::min(current.hi, r.hi)};
+    if (narrowed.lo <= narrowed.hi)
+        set(addr, narrowed);
+}
+
+void DataFlow::havoc()
+{
+    d_tape.cells.clear();
+    d_tape.beyond = top();
+}
+
+void DataFlow::havoc(int const extent)
+{
+    if (extent > (int)d_tape.cells.size())
+        d_tape.cells.resize(extent, d_tape.beyond);
+
+    std::fill(d_tape.cells.begin(), d_tape.cells.begin() + extent, top());
+}
+
+std::string DataFlow::process(std::string const &bf, int const endPointer, int const extent)
+{
+    if (!d_enabled)
+        return bf;
+
+    d_loops.clear();
+    std::string out;
+    size_t idx = 0;
+    while (idx != bf.size())
+    {
+        if (bf[idx] == '[' && !loopInfo(bf, idx).balanced)
+        {
+            // Unbalanced loops (used to index arrays at runtime) make us lose track
+            // of the pointer. They only ever visit allocated memory, so what is known
+            // about the cells beyond the extent of the memory remains valid.
+            out += bf.substr(idx);
+            havoc(extent);
+            d_pointer = endPointer;
+            return out;
+        }
+        idx = step(bf, idx, bf.size(), out);
+    }
+
+    assert(d_pointer == endPointer && "pointer out of sync with generator");
+    return out;
+}
+
+DataFlow::LoopInfo const &DataFlow::loopInfo(std::string const &bf, size_t const open)
+{
+    auto const it = d_loops.find(open);
+    if (it != d_loops.end())
+        return it->second;
+
+    LoopInfo info;
+    int offset = 0;
+    size_t idx = open + 1;
+    while (bf[idx] != ']')
+    {
+        switch (bf[idx])
+        {
+        case '>': ++offset; break;
+        case '<': --offset; break;
+        case '+':
+        case '-':
+            {
+                info.deltas[offset] += (bf[idx] == '+') ? 1 : -1;
+                info.writes.insert(offset);
+                break;
+            }
+        case ',':
+        case '?':
+            {
+                info.writes.insert(offset);
+                info.simple = false;
+                break;
+            }
+        case '.':
+            {
+                info.simple = false;
+                break;
+            }
+        case '[':
+            {
+                LoopInfo const &inner = loopInfo(bf, idx);
+                info.simple = false;
+                info.balanced = info.balanced && inner.balanced;
+                for (int const w: inner.writes)
+                    info.writes.insert(offset + w);
+
+                idx = inner.end;
+                break;
+            }
+        default: break;
+        }
+        ++idx;
+    }
+
+    info.end = idx;
+    info.balanced = info.balanced && (offset == 0);
+    std::erase_if(info.deltas, [](auto const &pr){
+                                   return pr.second == 0;
+                               });
+
+    return (d_loops[open] = std::move(info));
+}
+
+size_t DataFlow::step(std::string const &bf, size_t const idx, size_t const end, std::string &out)
+{
+    switch (bf[idx])
+    {
+    case '>': ++d_pointer; break;
+    case '<': --d_pointer; break;
+    case '+': set(d_pointer, add(range(d_pointer), {1, 1})); break;
+    case '-': set(d_pointer, add(range(d_pointer), {-1, -1})); break;
+    case ',':
+    case '?': set(d_pointer, top()); break;
+    case '[': return loop(bf, idx, end, out);
+    default: break;
+    }
+
+    out += bf[idx];
+    return idx + 1;
+}
+
+void DataFlow::body(std::string const &bf, size_t const begin, size_t const end, std::string &out)
+{
+    int const ptr = d_pointer;
+    size_t idx = begin;
+    while (idx != end)
+        idx = step(bf, idx, end, out);
+
+    assert(d_pointer == ptr && "unbalanced loop-body");
+}
+
+size_t DataFlow::loop(std::string const &bf, size_t const open, size_t const end, std::string &out)
+{
+    LoopInfo const &info = loopInfo(bf, open);
+    int const ptr = d_pointer;
+    Range const cond = range(ptr);
+    size_t const next = info.end + 1;
+
+    // Loop is never entered
+    if (cond == Range{0, 0})
+        return next;
+
+    auto const delta = info.deltas.find(0);
+    if (info.simple && delta != info.deltas.end())
+    {
+        if (info.deltas.size() == 1 && std::abs(delta->second) == 1)
+            return clearLoop(bf, open, end, out);
+
+        if (delta->second == -1)
+        {
+            // Linear loop: runs exactly cond times, every iteration adding a constant
+            // amount to the other cells.
+            for (auto const &[offset, amount]: info.deltas)
+            {
+                if (offset == 0)
+                    continue;
+
+                Range const total = (amount > 0) ?
+                    Range{cond.lo * amount, cond.hi * amount} :
+                    Range{cond.hi * amount, cond.lo * amount};
+
+                set(ptr + offset, add(range(ptr + offset), total));
+            }
+
+            set(ptr, {0, 0});
+            out += bf.substr(open, next - open);
+            return next;
+        }
+    }
+
+    // General case: anything written in the body is unknown at the start of
+    // an iteration.
+    std::vector<std::pair<int, Range>> entry;
+    for (int const offset: info.writes)
+        entry.emplace_back(ptr + offset, range(ptr + offset));
+
+    for (auto const &pr: entry)
+        set(pr.first, top());
+
+    set(ptr, nonZero(range(ptr)));
+    std::string bodyOut;
+    body(bf, open + 1, info.end, bodyOut);
+
+    if (range(ptr) == Range{0, 0})
+    {
+        // The body always leaves the condition zero, so it is executed at most
+        // once. Analyze it again, starting from the facts on entry.
+        for (auto const &pr: entry)
+            set(pr.first, pr.second);
+
+        set(ptr, nonZero(cond));
+        bodyOut.clear();
+        body(bf, open + 1, info.end, bodyOut);
+
+        if (cond.lo > 0)
+        {
+            // Executed exactly once -> brackets can be removed
+            out += bodyOut;
+            return next;
+        }
+    }
+
+    out += '[' + bodyOut + ']';
+    for (auto const &pr: entry)
+        set(pr.first, join(range(pr.first), pr.second));
+
+    set(ptr, {0, 0});
+    return next;
+}
+
+size_t DataFlow::clearLoop(std::string const &bf, size_t const open, size_t const end, std::string &out)
+{
+    int const ptr = d_pointer;
+    Range const cond = range(ptr);
+    size_t const next = loopInfo(bf, open).end + 1;
+    std::string const clear = bf.substr(open, next - open);
+
+    if (!cond.known())
+    {
+        out += clear;
+        set(ptr, {0, 0});
+        return next;
+    }
+
+    // The value is known: the clear and the adjustment that follows it can be
+    // replaced by the shortest sequence that takes the cell to its final value.
+    size_t idx = next;
+    long amount = 0;
+    while (idx != end && (bf[idx] == '+' || bf[idx] == '-'))
+        amount += (bf[idx++] == '+') ? 1 : -1;
+
+    long const target = add({0, 0}, {amount, amount}).lo;
+    if (deltaLength(cond.lo, target) <= (long)clear.size() + deltaLength(0, target))
+        out += shortestDelta(cond.lo, target);
+    else
+        out += clear + shortestDelta(0, target);
+
+    set(ptr, {target, target});
+    return idx;
+}
+
+long DataFlow::deltaLength(long const from, long const to) const
+{
+    long const mod = d_maxValue + 1;
+    long const diff = (((to - from) % mod) + mod) % mod;
+    return std::min(diff, mod - diff);
+}
+
+std::string DataFlow::shortestDelta(long const from, long const to) const
+{
+    long const mod = d_maxValue + 1;
+    long const diff = (((to - from) % mod) + mod) % mod;
+    return (diff <= mod - diff) ? std::string(diff, '+') : std::string(mod - diff, '-');
+}
+
+void DataFlow::beginBlock(int const flag, Block const type, size_t const pos)
+{
+    if (!d_enabled)
+    {
+        d_blocks.push_back({{}, pos, flag, type});
+        return;
+    }
+
+    assert(d_pointer == flag && "pointer should be at flag when entering block");
+
+    d_blocks.push_back({d_tape, pos, flag, type});
+    if (type == Block::LOOP)
+        havoc();
+
+    set(flag, nonZero(range(flag)));
+}
+
+std::tuple<DataFlow::Block, DataFlow::Fold, size_t> DataFlow::endBlock()
+{
+    if (!d_enabled)
+    {
+        Block const type = d_blocks.back().type;
+        d_blocks.pop_back();
+        return {type, Fold::KEEP, 0};
+    }
+
+    BlockInfo block = std::move(d_blocks.back());
+    d_blocks.pop_back();
+
+    assert(d_pointer == block.flag && "pointer should be at flag when leaving block");
+
+    int const flag = block.flag;
+    Range const cond = (flag < (int)block.entry.cells.size()) ?
+        block.entry.cells[flag] : block.entry.beyond;
+
+    if (cond == Range{0, 0})
+    {
+        // Never entered
+        d_tape = std::move(block.entry);
+        return {block.type, Fold::DROP, block.pos};
+    }
+
+    bool const once = (block.type == Block::ONCE) || (range(flag) == Range{0, 0});
+    if (once && cond.lo > 0)
+    {
+        // Entered exactly once
+        assert((range(flag) == Range{0, 0}) && "flag should be zero at end of block");
+        return {block.type, Fold::UNWRAP, block.pos};
+    }
+
+    // Join the facts on entry (block skipped) and exit
+    Tape &entry = block.entry;
+    size_t const n = std::max(entry.cells.size(), d_tape.cells.size());
+    entry.cells.resize(n, entry.beyond);
+    d_tape.cells.resize(n, d_tape.beyond);
+    for (size_t idx = 0; idx != n; ++idx)
+        d_tape.cells[idx] = join(d_tape.cells[idx], entry.cells[idx]);
+
+    d_tape.beyond = join(d_tape.beyond, entry.beyond);
+    set(flag, {0, 0});
+    return {block.type, Fold::KEEP, block.pos};
+}
+
+void DataFlow::jump(int const pointer)
+{
+    // Entry point of code that is executed from different places: nothing is
+    // known about the tape.
+    havoc();
+    d_pointer = pointer;
+}
+
+void DataFlow::resume(int const pointer, int const extent)
+{
+    // Control returns from code that was not analyzed here, which only used the
+    // cells below extent.
+    havoc(extent);
+    d_pointer = pointer;
+}
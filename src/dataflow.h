@@ -0,0 +1,115 @@
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <tuple>
+
+// DataFlow keeps track of what is known about the contents of the tape at the
+// current point of the generated program. Every piece of BF-code emitted by the
+// compiler is interpreted abstractly: each cell is described by the range of
+// values [lo, hi] it can hold at runtime. While doing so, the code is rewritten
+// where these facts allow it (clearing a cell that is known to be zero, dead loops,
+// loops that are known to run exactly once).
+
+class DataFlow
+{
+public:
+    struct Range
+    {
+        long lo;
+        long hi;
+
+        bool known() const
+        {
+            return lo == hi;
+        }
+
+        bool operator==(Range const &other) const = default;
+    };
+
+    enum class Block
+        {
+         ONCE,  // body is executed at most once (if-statement)
+         LOOP   // body may be executed any number of times
+        };
+
+    enum class Fold
+        {
+         KEEP,   // keep the block as is
+         DROP,   // block is never entered -> remove it entirely
+         UNWRAP  // block is entered exactly once -> remove the brackets
+        };
+
+private:
+    struct Tape
+    {
+        std::vector<Range> cells;
+        Range              beyond{0, 0}; // applies to all cells not in the vector
+    };
+
+    struct BlockInfo
+    {
+        Tape   entry;
+        size_t pos;
+        int    flag;
+        Block  type;
+    };
+
+    struct LoopInfo
+    {
+        size_t              end{0};
+        bool                balanced{true};
+        bool                simple{true};
+        std::map<int, long> deltas;
+        std::set<int>       writes;
+    };
+
+    long       d_maxValue;
+    bool       d_enabled;
+    Tape       d_tape;
+    int        d_pointer{0};
+
+    std::vector<BlockInfo> d_blocks;
+    std::map<size_t, LoopInfo> d_loops;
+
+public:
+    DataFlow(long const maxValue, bool const enabled = true):
+        d_maxValue(maxValue),
+        d_enabled(enabled)
+    {}
+
+    std::string process(std::string const &bf, int const endPointer, int const extent);
+    void beginBlock(int const flag, Block const type, size_t const pos);
+    std::tuple<Block, Fold, size_t> endBlock();
+    void jump(int const pointer);
+    void resume(int const pointer, int const extent);
+
+    Range range(int const addr) const;
+    Range bounds(int const addr) const;
+    bool known(int const addr) const;
+    long value(int const addr) const;
+    void assume(int const addr, Range const &r);
+
+private:
+    Range top() const;
+    Range nonZero(Range const &r) const;
+    Range add(Range const &r, Range const &amount) const;
+    static Range join(Range const &r1, Range const &r2);
+
+    void set(int const addr, Range const &r);
+    void havoc();
+    void havoc(int const extent);
+
+    LoopInfo const &loopInfo(std::string const &bf, size_t const open);
+    size_t step(std::string const &bf, size_t const idx, size_t const end, std::string &out);
+    size_t loop(std::string const &bf, size_t const open, size_t const end, std::string &out);
+    size_t clearLoop(std::string const &bf, size_t const open, size_t const end, std::string &out);
+    void body(std::string const &bf, size_t const begin, size_t const end, std::string &out);
+    std::string shortestDelta(long const from, long const to) const;
+    long deltaLength(long const from, long const to) const;
+};
+
+#endif //DATAFLOW_H
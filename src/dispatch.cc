@@ -0,0 +1,309 @@
+#include "dispatch.ih"
+
+void Dispatch::enable(bool const enabled)
+{
+    d_enabled = enabled;
+}
+
+bool Dispatch::enabled() const
+{
+    return d_enabled;
+}
+
+std::string Dispatch::block(int const flag) const
+{
+    return d_enabled ? (BLOCK + std::to_string(flag) + BLOCK) : "";
+}
+
+size_t Dispatch::headerLength(std::string const &code, size_t const pos)
+{
+    assert(code[pos] == '[' && "expected the start of a block");
+    if (pos + 1 == code.size() || code[pos + 1] != BLOCK)
+        return 1;
+
+    return code.find(BLOCK, pos + 2) - pos + 1;
+}
+
+size_t Dispatch::declare()
+{
+    d_routines.push_back({});
+    return d_routines.size() - 1;
+}
+
+void Dispatch::define(size_t const routine, std::string const &code, int const begin, int const end)
+{
+    d_routines[routine] = {code, begin, end};
+}
+
+std::string Dispatch::call(size_t const routine, int const pointer)
+{
+    d_calls.push_back({routine, pointer});
+    return CALL + std::to_string(d_calls.size() - 1) + CALL;
+}
+
+int Dispatch::number(std::string const &code, size_t &idx)
+{
+    // idx points to the opening marker and is moved past the closing one
+    size_t const close = code.find(code[idx], idx + 1);
+    int const result = std::stoi(code.substr(idx + 1, close - idx - 1));
+    idx = close + 1;
+    return result;
+}
+
+std::string Dispatch::moves(int const from, int const to)
+{
+    return (to > from) ? std::string(to - from, '>') : std::string(from - to, '<');
+}
+
+size_t Dispatch::addState(Program &prog, int const begin) const
+{
+    prog.states.push_back({"", begin});
+    return prog.states.size() - 1;
+}
+
+size_t Dispatch::split(Program &prog, std::string const &code, size_t &idx, size_t current) const
+{
+    // Copy the code into the current state up to the end of the enclosing block.
+    // A new state is started after every call and around every block that contains
+    // a call. Returns the state that is current at the end.
+    
+    while (idx != code.size() && code[idx] != ']')
+    {
+        if (code[idx] == CALL)
+        {
+            size_t const id = number(code, idx);
+            Call const &call = d_calls[id];
+            size_t const next = addState(prog, call.pointer);
+
+            State &state = prog.states[current];
+            state.end  = call.pointer;
+            state.exit = Exit::CALL;
+            state.arg  = id;
+
+            prog.continuation[id] = next;
+            if (!prog.queued[call.routine])
+            {
+                prog.queued[call.routine] = true;
+                prog.pending.push_back(call.routine);
+            }
+
+            current = next;
+            continue;
+        }
+
+        if (code[idx] != '[')
+        {
+            prog.states[current].code += code[idx++];
+            continue;
+        }
+
+        // Find the end of the block and check if it contains a call
+        size_t end = idx + headerLength(code, idx);
+        int depth = 1;
+        bool calls = false;
+        for (; depth != 0; ++end)
+        {
+            if (code[end] == '[')
+                ++depth;
+            else if (code[end] == ']')
+                --depth;
+            else if (code[end] == CALL)
+                calls = true;
+        }
+
+        if (!calls)
+        {
+            std::string &out = prog.states[current].code;
+            for (; idx != end; ++idx)
+            {
+                if (code[idx] == BLOCK)
+                    idx = code.find(BLOCK, idx + 1);
+                else
+                    out += code[idx];
+            }
+            continue;
+        }
+
+        // The block is split into a state that tests the flag (at the end of the
+        // current state and at the end of the body), the body and the state that
+        // follows the block.
+        assert(code[idx + 1] == BLOCK && "call inside a block that is not a runtime block");
+        ++idx;
+        int const flag = number(code, idx);
+        size_t const body = addState(prog, flag);
+        size_t const last = split(prog, code, idx, body);
+        assert(code[idx] == ']' && "unterminated block");
+        ++idx;
+
+        size_t const after = addState(prog, flag);
+        for (size_t const s: {current, last})
+        {
+            State &state = prog.states[s];
+            state.end  = flag;
+            state.exit = Exit::BRANCH;
+            state.arg  = flag;
+            state.next = body;
+            state.skip = after;
+        }
+        
+        current = after;
+    }
+
+    return current;
+}
+
+std::string Dispatch::assemble(std::string const &main, int const mainEnd, int const base, int &cells) const
+{
+    size_t const mainRoutine = d_routines.size();
+    
+    Program prog;
+    prog.entry.assign(mainRoutine + 1, NONE);
+    prog.queued.assign(mainRoutine + 1, false);
+    prog.continuation.assign(d_calls.size(), NONE);
+
+    auto const process =
+        [&](size_t const routine, std::string const &code, int const begin, int const end)
+        {
+            size_t idx = 0;
+            prog.entry[routine] = addState(prog, begin);
+            size_t const last = split(prog, code, idx, prog.entry[routine]);
+            assert(idx == code.size() && "unbalanced brackets in routine");
+
+            State &state = prog.states[last];
+            state.end  = end;
+            state.exit = (routine == mainRoutine) ? Exit::HALT : Exit::RETURN;
+            state.arg  = routine;
+        };
+
+    process(mainRoutine, main, 0, mainEnd);
+    if (prog.states.size() == 1)
+    {
+        // No calls are left, so there's nothing to dispatch
+        cells = 0;
+        return prog.states[0].code;
+    }
+
+    while (!prog.pending.empty())
+    {
+        size_t const routine = prog.pending.back();
+        prog.pending.pop_back();
+
+        Routine const &r = d_routines[routine];
+        process(routine, r.code, r.begin, r.end);
+    }
+
+    // Layout of the cells used by the dispatcher: a flag that keeps the loop
+    // running, two temporaries, a flag for each state and for each return-site.
+    int const run  = base;
+    int const tmp1 = base + 1;
+    int const tmp2 = base + 2;
+    auto const flag = [&](size_t const state) -> int
+                      {
+                          return base + 3 + state;
+                      };
+
+    std::vector<int> returnFlag(d_calls.size(), -1);
+    int next = flag(prog.states.size());
+    for (size_t id = 0; id != d_calls.size(); ++id)
+    {
+        if (prog.continuation[id] != NONE)
+            returnFlag[id] = next++;
+    }
+    cells = next - base;
+
+    std::string out;
+    int ptr = 0;
+    auto const go = [&](int const addr)
+                    {
+                        out += moves(ptr, addr);
+                        ptr = addr;
+                    };
+
+    go(run);
+    out += '+';
+    go(flag(prog.entry[mainRoutine]));
+    out += '+';
+    go(run);
+    out += '[';
+    
+    for (size_t s = 0; s != prog.states.size(); ++s)
+    {
+        State const &state = prog.states[s];
+        go(flag(s));
+        out += "[-";
+        go(state.begin);
+        out += state.code;
+        ptr = state.end;
+
+        switch (state.exit)
+        {
+        case Exit::BRANCH:
+            {
+                // Test the flag of the block without destroying it
+                int const cond = state.arg;
+                go(cond);
+                out += "[-";
+                go(tmp1);
+                out += '+';
+                go(tmp2);
+                out += '+';
+                go(cond);
+                out += ']';
+                go(tmp2);
+                out += "[-";
+                go(cond);
+                out += '+';
+                go(tmp2);
+                out += ']';
+                go(flag(state.skip));
+                out += '+';
+                go(tmp1);
+                out += "[[-]";
+                go(flag(state.next));
+                out += '+';
+                go(flag(state.skip));
+                out += '-';
+                go(tmp1);
+                out += ']';
+                break;
+            }
+        case Exit::CALL:
+            {
+                go(returnFlag[state.arg]);
+                out += '+';
+                go(flag(prog.entry[d_calls[state.arg].routine]));
+                out += '+';
+                break;
+            }
+        case Exit::RETURN:
+            {
+                for (size_t id = 0; id != d_calls.size(); ++id)
+                {
+                    if (d_calls[id].routine != state.arg || returnFlag[id] < 0)
+                        continue;
+
+                    go(returnFlag[id]);
+                    out += "[-";
+                    go(flag(prog.continuation[id]));
+                    out += '+';
+                    go(returnFlag[id]);
+                    out += ']';
+                }
+                break;
+            }
+        case Exit::HALT:
+            {
+                go(run);
+                out += '-';
+                break;
+            }
+        }
+
+        go(flag(s));
+        out += ']';
+    }
+
+    go(run);
+    out += ']';
+    return out;
+}
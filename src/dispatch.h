@@ -0,0 +1,89 @@
+#ifndef DISPATCH_H
+#define DISPATCH_H
+
+#include <string>
+#include <vector>
+
+// Dispatch implements the out-of-line calling convention. The body of a function
+// that is called out-of-line is generated only once, as a separate routine. In the
+// code of the callers, each call is marked by a placeholder and each runtime block
+// is marked with the address of its flag. When the program is complete, all
+// routines are split into states at the calls and around the runtime blocks that
+// contain calls. The states are placed in a single top-level loop, each guarded by
+// a flag of its own: a state that finishes sets the flag of its successor. A call
+// sets the flag of its return-site and the flag of the entry of the callee, which
+// upon returning passes control to the state following the call.
+
+class Dispatch
+{
+public:
+    static constexpr char BLOCK = '\1';
+    static constexpr char CALL  = '\2';
+
+private:
+    struct Routine
+    {
+        std::string code;
+        int begin;
+        int end;
+    };
+
+    struct Call
+    {
+        size_t routine;
+        int    pointer;
+    };
+
+    enum class Exit
+        {
+         BRANCH, // continue at next if the flag is nonzero, at skip otherwise
+         CALL,   // call the routine of d_calls[arg]
+         RETURN, // return from routine arg
+         HALT    // end of the program
+        };
+
+    struct State
+    {
+        std::string code;
+        int    begin;
+        int    end{0};
+        Exit   exit{Exit::HALT};
+        size_t arg{0};
+        size_t next{0};
+        size_t skip{0};
+    };
+
+    struct Program
+    {
+        std::vector<State>  states;
+        std::vector<size_t> entry;         // routine -> first state
+        std::vector<size_t> continuation;  // call -> state after the call
+        std::vector<bool>   queued;
+        std::vector<size_t> pending;       // routines still to be split
+    };
+
+    static constexpr size_t NONE = -1;
+
+    bool                 d_enabled{false};
+    std::vector<Routine> d_routines;
+    std::vector<Call>    d_calls;
+
+public:
+    void enable(bool const enabled);
+    bool enabled() const;
+    std::string block(int const flag) const;
+    static size_t headerLength(std::string const &code, size_t const pos);
+
+    size_t declare();
+    void define(size_t const routine, std::string const &code, int const begin, int const end);
+    std::string call(size_t const routine, int const pointer);
+    std::string assemble(std::string const &main, int const mainEnd, int const base, int &cells) const;
+
+private:
+    size_t split(Program &prog, std::string const &code, size_t &idx, size_t current) const;
+    size_t addState(Program &prog, int const begin) const;
+    static int number(std::string const &code, size_t &idx);
+    static std::string moves(int const from, int const to);
+};
+
+#endif //DISPATCH_H
@@ -3,6 +3,11 @@
 #include <csignal>
 #include <fstream>
 #include <sstream>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <iomanip>
+#include <sys/resource.h>
 
 #ifdef USE_CURSES
 #include <ncurses.h>
@@ -38,7 +43,12 @@ BFInterpreter::BFInterpreter(Options const &opt):
     d_randMax(opt.randMax),
     d_randomWarningEnabled(opt.randomWarningEnabled),
     d_gamingMode(opt.gamingMode),
-    d_testFile(opt.testFile)
+    d_testFile(opt.testFile),
+    d_profileFile(opt.profileFile),
+    d_sourceMapFile(opt.sourceMapFile),
+    d_stats(opt.stats),
+    d_statsJsonFile(opt.statsJsonFile),
+    d_rssFile(opt.rssFile)
 {
     // init code
     std::ifstream file(opt.bfFile);
@@ -50,9 +60,14 @@ BFInterpreter::BFInterpreter(Options const &opt):
     d_code = buffer.str();
 
     // init rng
-    auto t0 = std::chrono::system_clock::now().time_since_epoch();
-    auto ms = duration_cast<std::chrono::milliseconds>(t0).count();
-    d_rng.seed(ms);
+    if (opt.seed >= 0)
+        d_rng.seed(opt.seed);
+    else
+    {
+        auto t0 = std::chrono::system_clock::now().time_since_epoch();
+        auto ms = duration_cast<std::chrono::milliseconds>(t0).count();
+        d_rng.seed(ms);
+    }
 }
 
 void BFInterpreter::reset()
@@ -66,7 +81,30 @@ void BFInterpreter::reset()
 int BFInterpreter::run()
 {
     if (d_testFile.empty())
-        return run(std::cin, std::cout);
+    {
+        bool const stats = d_stats || !d_statsJsonFile.empty();
+        if (!d_profileFile.empty() || stats)
+        {
+            d_profile.assign(d_code.size(), 0);
+            d_visited.assign(d_array.size(), false);
+        }
+
+        PerfCounters counters;
+        auto const t0 = std::chrono::steady_clock::now();
+        if (stats)
+            counters.start();
+
+        int const ret = run(std::cin, std::cout);
+
+        if (stats)
+            counters.stop();
+        std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - t0;
+
+        writeProfile();
+        writeStats(elapsed.count(), counters);
+        writeMaxRss();
+        return ret;
+    }
         
     auto const report =
         [](std::string const &testName, std::string const &caseName,
@@ -181,8 +219,35 @@ int BFInterpreter::run(std::istream &in, std::ostream &out)
     }
 #endif        
         
+    // Counting is compiled out of the loop unless it was requested
+    if (d_profile.empty())
+        execute<false>(in, out);
+    else
+        execute<true>(in, out);
+
+#ifdef USE_CURSES    
+    if (d_gamingMode)
+    {
+        nodelay(stdscr, false);
+        getch();
+        finish(0);
+    }
+#endif
+
+    return 0;
+}
+
+template <bool Counting>
+void BFInterpreter::execute(std::istream &in, std::ostream &out)
+{
     while (true)
     {
+        if constexpr (Counting)
+        {
+            ++d_profile[d_codePointer];
+            d_visited[d_arrayPointer] = true;
+        }
+        
         char token = d_code[d_codePointer];
         switch (token)
         {
@@ -245,17 +310,6 @@ int BFInterpreter::run(std::istream &in, std::ostream &out)
         if (++d_codePointer >= d_code.size())
             break;
     }
-
-#ifdef USE_CURSES    
-    if (d_gamingMode)
-    {
-        nodelay(stdscr, false);
-        getch();
-        finish(0);
-    }
-#endif
-
-    return 0;
 }
 
 int BFInterpreter::consume(Ops op)
@@ -310,7 +364,11 @@ void BFInterpreter::pointerInc()
     d_arrayPointer += n;
 
     while (d_arrayPointer >= d_array.size())
+    {
         d_array.resize(2 * d_array.size());
+        if (!d_visited.empty())
+            d_visited.resize(d_array.size());
+    }
 }
 
 void BFInterpreter::pointerDec()
@@ -615,3 +673,344 @@ void BFInterpreter::finish(int sig)
 #endif
 }
 
+
+bool BFInterpreter::readSourceMap(std::vector<int> &location, std::vector<std::string> &lines,
+                                  std::vector<std::string> &stacks) const
+{
+    // Every instruction is assigned the index of its range in the source map (or
+    // -1), which is used to look up its source line and call stack.
+    
+    std::ifstream mapFile(d_sourceMapFile);
+    if (!mapFile)
+        return false;
+
+    location.assign(d_code.size(), -1);
+    std::string entry;
+    while (std::getline(mapFile, entry))
+    {
+        if (entry.empty() || entry[0] == '#')
+            continue;
+
+        std::istringstream fields(entry);
+        size_t begin, end;
+        std::string file, line, stack;
+        fields >> begin >> end;
+        fields.ignore();
+        std::getline(fields, file, '\t');
+        std::getline(fields, line, '\t');
+        std::getline(fields, stack);
+
+        for (size_t idx = begin; idx < end && idx < d_code.size(); ++idx)
+            location[idx] = lines.size();
+        
+        lines.push_back(file + ':' + line);
+        stacks.push_back(stack);
+    }
+
+    return true;
+}
+
+size_t BFInterpreter::steps(size_t const idx) const
+{
+    // A run of +, -, < or > is always entered at its first instruction, where its
+    // full length is counted.
+
+    static std::string const instructions = "+-<>[].,?";
+    static std::string const runs = "+-<>";
+    
+    if (d_profile[idx] == 0 || instructions.find(d_code[idx]) == std::string::npos)
+        return 0;
+
+    size_t len = 1;
+    if (runs.find(d_code[idx]) != std::string::npos)
+    {
+        while (idx + len < d_code.size() && d_code[idx + len] == d_code[idx])
+            ++len;
+    }
+
+    return d_profile[idx] * len;
+}
+
+void BFInterpreter::writeProfile() const
+{
+    // The number of steps spent in each range of the source map is attributed to
+    // its source line and to the functions it was inlined into.
+    
+    if (d_profileFile.empty())
+        return;
+
+    std::vector<int> location;
+    std::vector<std::string> lines;
+    std::vector<std::string> stacks;
+    if (!readSourceMap(location, lines, stacks))
+    {
+        std::cerr << "ERROR: could not open source map " << d_sourceMapFile << '\n';
+        return;
+    }
+
+    std::map<std::string, size_t> perLine;
+    std::map<std::string, size_t> perStack;
+    size_t total = 0;
+    for (size_t idx = 0; idx != d_code.size(); ++idx)
+    {
+        size_t const n = steps(idx);
+        if (n == 0)
+            continue;
+
+        int const loc = location[idx];
+        perLine[(loc == -1) ? "(unmapped)" : lines[loc]] += n;
+        perStack[(loc == -1) ? "(unmapped)" : stacks[loc]] += n;
+        total += n;
+    }
+    // Self: steps of the innermost function. Total: including the functions it calls.
+    std::map<std::string, std::pair<size_t, size_t>> perFunction;
+    for (auto const &[stack, steps]: perStack)
+    {
+        std::set<std::string> seen;
+        std::istringstream frames(stack);
+        std::string frame;
+        while (std::getline(frames, frame, ';'))
+        {
+            if (seen.insert(frame).second)
+                perFunction[frame].second += steps;
+        }
+        perFunction[frame].first += steps;
+    }
+
+    auto const sorted = [](auto const &map, auto const &key){
+                            std::vector<std::pair<std::string, typename std::decay_t<decltype(map)>::mapped_type>>
+                                result(map.begin(), map.end());
+                            std::stable_sort(result.begin(), result.end(),
+                                             [&](auto const &x, auto const &y){
+                                                 return key(x.second) > key(y.second);
+                                             });
+                            return result;
+                        };
+
+    auto const percentage = [&](size_t const steps){
+                                std::ostringstream out;
+                                out << std::fixed << std::setprecision(1)
+                                    << (total ? 100.0 * steps / total : 0.0) << '%';
+                                return out.str();
+                            };
+    
+    std::ofstream out(d_profileFile);
+    if (!out)
+    {
+        std::cerr << "ERROR: could not open profile-file " << d_profileFile << '\n';
+        return;
+    }
+
+    out << "Number of steps executed: " << total << "\n\n"
+        << "Lines:\n"
+        << std::setw(14) << "steps" << std::setw(8) << "%" << "  location\n";
+    
+    for (auto const &[line, steps]: sorted(perLine, [](size_t s){ return s; }))
+        out << std::setw(14) << steps << std::setw(8) << percentage(steps) << "  " << line << '\n';
+
+    out << "\nFunctions (self: the function itself, total: including the functions it calls):\n"
+        << std::setw(14) << "self" << std::setw(8) << "%"
+        << std::setw(14) << "total" << std::setw(8) << "%" << "  function\n";
+
+    for (auto const &[function, steps]: sorted(perFunction, [](auto const &s){ return s.second; }))
+        out << std::setw(14) << steps.first << std::setw(8) << percentage(steps.first)
+            << std::setw(14) << steps.second << std::setw(8) << percentage(steps.second)
+            << "  " << function << '\n';
+
+    // Folded stacks, as used by flamegraph.pl and compatible tools
+    std::ofstream folded(d_profileFile + ".folded");
+    for (auto const &[stack, steps]: perStack)
+        folded << stack << ' ' << steps << '\n';
+}
+
+void BFInterpreter::writeStats(double const seconds, PerfCounters const &counters) const
+{
+    if (!d_stats && d_statsJsonFile.empty())
+        return;
+
+    static constexpr size_t TOP_LOOPS = 10;
+    static std::string const kinds = "+-<>[].,?";
+
+    std::map<char, size_t> ops;
+    std::vector<size_t> cumulative(d_code.size() + 1, 0);
+    for (size_t idx = 0; idx != d_code.size(); ++idx)
+    {
+        size_t const n = steps(idx);
+        cumulative[idx + 1] = cumulative[idx] + n;
+        if (n != 0)
+            ops[d_code[idx]] += n;
+    }
+
+    // Loops, with the steps spent in their bodies (including nested loops)
+    struct Loop
+    {
+        size_t begin;
+        size_t end;
+        size_t steps;
+    };
+    
+    std::vector<Loop> loops;
+    std::stack<size_t> open;
+    for (size_t idx = 0; idx != d_code.size(); ++idx)
+    {
+        if (d_code[idx] == START_LOOP)
+            open.push(idx);
+        else if (d_code[idx] == END_LOOP && !open.empty())
+        {
+            size_t const begin = open.top();
+            open.pop();
+            if (d_profile[begin] != 0)
+                loops.push_back({begin, idx, cumulative[idx + 1] - cumulative[begin]});
+        }
+    }
+
+    std::stable_sort(loops.begin(), loops.end(), [](Loop const &x, Loop const &y){
+                                                     return x.steps > y.steps;
+                                                 });
+    if (loops.size() > TOP_LOOPS)
+        loops.resize(TOP_LOOPS);
+
+    // The location of a loop is only listed when a source map is available
+    std::vector<int> location;
+    std::vector<std::string> lines;
+    std::vector<std::string> stacks;
+    bool const mapped = readSourceMap(location, lines, stacks);
+    auto const where = [&](size_t const idx) -> std::string {
+                           return (!mapped || location[idx] == -1) ? "" : lines[location[idx]];
+                       };
+
+    size_t maxPointer = 0;
+    size_t visited = 0;
+    for (size_t idx = 0; idx != d_visited.size(); ++idx)
+    {
+        if (!d_visited[idx])
+            continue;
+        
+        maxPointer = idx;
+        ++visited;
+    }
+
+    int const cellSize = (d_cellType == CellType::INT8) ? 1 : (d_cellType == CellType::INT16) ? 2 : 4;
+    size_t const total = cumulative.back();
+
+    long const maxRss = BFInterpreter::maxRss();
+
+    if (d_stats)
+    {
+        std::ostream &out = std::cerr;
+        out << "\nExecution statistics:\n"
+            << "    wall time:      " << std::fixed << std::setprecision(3) << seconds << " s\n"
+            << "    steps:          " << total << '\n';
+
+        for (char const c: kinds)
+            out << "      " << c << "             " << ops[c] << '\n';
+
+        out << "    max pointer:    " << maxPointer << '\n'
+            << "    cells visited:  " << visited << " (" << visited * cellSize << " bytes)\n"
+            << "    output bytes:   " << ops[PRINT] << '\n'
+            << "    input bytes:    " << ops[READ] << '\n'
+            << "    max RSS:        " << maxRss << " kB\n";
+
+        for (int c = 0; c != PerfCounters::N_COUNTERS; ++c)
+        {
+            auto const counter = static_cast<PerfCounters::Counter>(c);
+            std::string label = PerfCounters::name(counter) + ":";
+            std::replace(label.begin(), label.end(), '_', ' ');
+            out << "    " << std::left << std::setw(16) << label << std::right;
+            if (counters.available(counter))
+                out << counters.value(counter) << '\n';
+            else
+                out << "unavailable\n";
+        }
+
+        out << "\nHottest loops (steps include nested loops):\n"
+            << std::setw(10) << "offset" << std::setw(12) << "entries"
+            << std::setw(14) << "iterations" << std::setw(14) << "steps" << "  location\n";
+        
+        for (Loop const &loop: loops)
+            out << std::setw(10) << loop.begin << std::setw(12) << d_profile[loop.begin]
+                << std::setw(14) << d_profile[loop.end] << std::setw(14) << loop.steps
+                << "  " << where(loop.begin) << '\n';
+    }
+
+    if (!d_statsJsonFile.empty())
+    {
+        std::ofstream out(d_statsJsonFile);
+        if (!out)
+        {
+            std::cerr << "ERROR: could not open stats-file " << d_statsJsonFile << '\n';
+            return;
+        }
+
+        auto const quoted = [](std::string const &str){
+                                std::string result = "\"";
+                                for (char const c: str)
+                                    result += (c == '"' || c == '\\') ? std::string("\\") + c : std::string(1, c);
+                                return result + '"';
+                            };
+        
+        out << "{\n"
+            << "  \"wall_time_s\": " << std::fixed << std::setprecision(6) << seconds << ",\n"
+            << "  \"steps\": " << total << ",\n"
+            << "  \"ops\": {";
+        
+        for (size_t idx = 0; idx != kinds.size(); ++idx)
+            out << (idx ? ", " : "") << quoted(std::string(1, kinds[idx])) << ": " << ops[kinds[idx]];
+
+        out << "},\n"
+            << "  \"max_pointer\": " << maxPointer << ",\n"
+            << "  \"cells_visited\": " << visited << ",\n"
+            << "  \"bytes_visited\": " << visited * cellSize << ",\n"
+            << "  \"output_bytes\": " << ops[PRINT] << ",\n"
+            << "  \"input_bytes\": " << ops[READ] << ",\n"
+            << "  \"max_rss_kb\": " << maxRss << ",\n"
+            << "  \"perf\": {";
+
+        for (int c = 0; c != PerfCounters::N_COUNTERS; ++c)
+        {
+            auto const counter = static_cast<PerfCounters::Counter>(c);
+            out << (c ? ", " : "") << quoted(PerfCounters::name(counter)) << ": ";
+            if (counters.available(counter))
+                out << counters.value(counter);
+            else
+                out << "null";
+        }
+
+        out << "},\n"
+            << "  \"loops\": [";
+
+        for (size_t idx = 0; idx != loops.size(); ++idx)
+        {
+            Loop const &loop = loops[idx];
+            out << (idx ? "," : "") << "\n    {\"offset\": " << loop.begin
+                << ", \"entries\": " << d_profile[loop.begin]
+                << ", \"iterations\": " << d_profile[loop.end]
+                << ", \"steps\": " << loop.steps
+                << ", \"location\": " << quoted(where(loop.begin)) << '}';
+        }
+
+        out << (loops.empty() ? "" : "\n  ") << "]\n"
+            << "}\n";
+    }
+}
+
+void BFInterpreter::writeMaxRss() const
+{
+    if (d_rssFile.empty())
+        return;
+
+    std::ofstream out(d_rssFile);
+    if (!out)
+    {
+        std::cerr << "ERROR: could not open rss-file " << d_rssFile << '\n';
+        return;
+    }
+
+    out << maxRss() << '\n';
+}
+
+long BFInterpreter::maxRss()
+{
+    rusage usage;
+    return (getrusage(RUSAGE_SELF, &usage) == 0) ? usage.ru_maxrss : 0; // kB
+}
@@ -5,6 +5,7 @@
 #include <stack>
 #include <random>
 #include <iostream>
+#include "perfcounters.h"
 
 enum class CellType
     {
@@ -22,8 +23,14 @@ struct Options
     std::string  testFile;
     bool         randomEnabled{false};
     int          randMax{0};
+    long         seed{-1};
     bool         randomWarningEnabled{true};
     bool         gamingMode{false};
+    std::string  profileFile;
+    std::string  sourceMapFile;
+    bool         stats{false};
+    std::string  statsJsonFile;
+    std::string  rssFile;
 };
 
 class BFInterpreter
@@ -33,6 +40,8 @@ class BFInterpreter
     size_t d_arrayPointer{0};
     size_t d_codePointer{0};
     std::stack<int> d_loopStack;
+    std::vector<size_t> d_profile; // number of times each instruction was executed
+    std::vector<bool> d_visited;   // cells on which an instruction was executed
 
     using RngType = std::mt19937;
     std::uniform_int_distribution<RngType::result_type> d_uniformDist;
@@ -45,6 +54,11 @@ class BFInterpreter
     bool const d_randomWarningEnabled{true};
     bool const d_gamingMode{false};
     std::string const d_testFile;
+    std::string const d_profileFile;
+    std::string const d_sourceMapFile;
+    bool const d_stats{false};
+    std::string const d_statsJsonFile;
+    std::string const d_rssFile;
     
     enum Ops: char
         {
@@ -65,6 +79,8 @@ public:
 
 private:
     int run(std::istream &in, std::ostream &out);
+    template <bool Counting>
+    void execute(std::istream &in, std::ostream &out);
     int consume(Ops op);
     void plus();
     void minus();
@@ -82,6 +98,13 @@ private:
     static void finish(int sig);
     void runTests();
     void reset();
+    bool readSourceMap(std::vector<int> &location, std::vector<std::string> &lines,
+                       std::vector<std::string> &stacks) const;
+    size_t steps(size_t const idx) const;
+    void writeProfile() const;
+    void writeStats(double const seconds, PerfCounters const &counters) const;
+    void writeMaxRss() const;
+    static long maxRss();
 };
 
 
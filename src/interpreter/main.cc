@@ -20,6 +20,18 @@ void printHelp(std::string const &progName)
               << "--random            Enable Random Brainf*ck extension (support ?-symbol)\n"
               << "--rand-max [N]      Specifiy maximum value returned by RNG.\n"
               << "                      Defaults to maximum supported value of cell-type\n"
+              << "--seed [N]          Seed the RNG with N, to make runs with --random reproducible.\n"
+              << "--profile-out [file]\n"
+              << "                    Count the steps executed per source line and per function, and write\n"
+              << "                      them to [file]. Folded stacks (for flamegraphs) are written to\n"
+              << "                      [file].folded. Requires a source map, generated by bfx --source-map.\n"
+              << "--source-map [file] Source map to use with --profile-out ([target].map by default).\n"
+              << "--stats             Print statistics about the run to stderr: the number of executed\n"
+              << "                      operations per kind, the hottest loops, the memory and IO used,\n"
+              << "                      the wall time and (when available) hardware counters.\n"
+              << "--stats-json [file] Write the same statistics to [file] in JSON format.\n"
+              << "--rss-out [file]    Write the peak memory usage (max RSS) in kB to [file]. Unlike\n"
+              << "                      --stats, this does not slow down the run.\n"
               << "--no-random-warning Don't display a warning when ? occurs without running --random.\n\n"
               << "Example: " << progName << " --random -t int16 -o output.txt program.bf\n";
 }
@@ -180,6 +192,74 @@ Options parseCmdLine(std::vector<std::string> const &args)
             return opt;
         }
 #endif        
+        else if (args[idx] == "--profile-out" || args[idx] == "--source-map")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No filename passed to option \'" << args[idx] << "\'.\n";
+                opt.err = 1;
+                return opt;
+            }
+
+            (args[idx] == "--profile-out" ? opt.profileFile : opt.sourceMapFile) = args[idx + 1];
+            idx += 2;
+        }
+        else if (args[idx] == "--seed")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No argument passed to option '--seed'.\n";
+                opt.err = 1;
+                return opt;
+            }
+            try
+            {
+                opt.seed = std::stol(args[idx + 1]);
+                if (opt.seed < 0)
+                {
+                    std::cerr << "ERROR: seed must be a non-negative integer.\n";
+                    opt.err = 1;
+                    return opt;
+                }
+                
+                idx += 2;
+            }
+            catch (std::invalid_argument const&)
+            {
+                std::cerr << "ERROR: Invalid argument passed to option --seed\n";
+                opt.err = 1;
+                return opt;
+            }
+        }
+        else if (args[idx] == "--stats")
+        {
+            opt.stats = true;
+            ++idx;
+        }
+        else if (args[idx] == "--stats-json")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No filename passed to option '--stats-json'.\n";
+                opt.err = 1;
+                return opt;
+            }
+
+            opt.statsJsonFile = args[idx + 1];
+            idx += 2;
+        }
+        else if (args[idx] == "--rss-out")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No filename passed to option '--rss-out'.\n";
+                opt.err = 1;
+                return opt;
+            }
+
+            opt.rssFile = args[idx + 1];
+            idx += 2;
+        }
         else if (args[idx] == "--no-random-warning")
         {
             opt.randomWarningEnabled = false;
@@ -206,6 +286,13 @@ Options parseCmdLine(std::vector<std::string> const &args)
         opt.err = 1;
         return opt;
     }
+
+    if (opt.sourceMapFile.empty())
+    {
+        // Default: replace the extension of the target by .map
+        size_t const dot = opt.bfFile.find_last_of('.');
+        opt.sourceMapFile = opt.bfFile.substr(0, dot) + ".map";
+    }
     
     return opt;
 }
@@ -0,0 +1,100 @@
+#include "perfcounters.h"
+
+#ifdef __linux__
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+PerfCounters::PerfCounters()
+{
+    d_fd.fill(-1);
+    
+#ifdef __linux__
+    static unsigned long long const config[N_COUNTERS] = {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+    
+    for (int idx = 0; idx != N_COUNTERS; ++idx)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config[idx];
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        d_fd[idx] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int const fd: d_fd)
+    {
+        if (fd != -1)
+            close(fd);
+    }
+#endif
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+    for (int const fd: d_fd)
+    {
+        if (fd == -1)
+            continue;
+        
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+    for (int idx = 0; idx != N_COUNTERS; ++idx)
+    {
+        if (d_fd[idx] == -1)
+            continue;
+        
+        ioctl(d_fd[idx], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(d_fd[idx], &d_value[idx], sizeof(long long)) != sizeof(long long))
+        {
+            close(d_fd[idx]);
+            d_fd[idx] = -1;
+        }
+    }
+#endif
+}
+
+bool PerfCounters::available(Counter const counter) const
+{
+    return d_fd[counter] != -1;
+}
+
+long long PerfCounters::value(Counter const counter) const
+{
+    return d_value[counter];
+}
+
+std::string PerfCounters::name(Counter const counter)
+{
+    static std::string const names[N_COUNTERS] = {
+        "instructions",
+        "branch_misses",
+        "cache_misses"
+    };
+
+    return names[counter];
+}
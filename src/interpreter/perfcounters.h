@@ -0,0 +1,40 @@
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <array>
+#include <string>
+
+// PerfCounters reads the hardware counters of the CPU (through perf_event_open on
+// Linux) while the interpreter runs. Counters that cannot be opened, because the
+// platform or the permissions of the user do not allow it, are reported as
+// unavailable.
+
+class PerfCounters
+{
+public:
+    enum Counter
+        {
+         INSTRUCTIONS,
+         BRANCH_MISSES,
+         CACHE_MISSES,
+         N_COUNTERS
+        };
+
+private:
+    std::array<int, N_COUNTERS>       d_fd;
+    std::array<long long, N_COUNTERS> d_value{};
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(PerfCounters const &) = delete;
+    PerfCounters &operator=(PerfCounters const &) = delete;
+
+    void start();
+    void stop();
+    bool available(Counter const counter) const;
+    long long value(Counter const counter) const;
+    static std::string name(Counter const counter);
+};
+
+#endif //PERFCOUNTERS_H
@@ -0,0 +1,184 @@
+#include "layout.ih"
+
+std::string Layout::key(std::string const &ident, std::string const &scope)
+{
+    return scope + "::" + ident;
+}
+
+void Layout::declare(std::string const &ident, std::string const &scope, int const addr, int const size)
+{
+    if (!d_recording || size < MIN_SIZE)
+        return;
+
+    Variable &var = d_vars.insert({key(ident, scope), Variable{scope, size, {}}}).first->second;
+    if (var.instances.empty() || var.instances.back().end != ALIVE)
+        var.instances.push_back({addr, d_moves.size(), ALIVE});
+}
+
+void Layout::release(std::string const &ident, std::string const &scope)
+{
+    auto const it = d_vars.find(key(ident, scope));
+    if (it == d_vars.end() || it->second.instances.empty())
+        return;
+
+    Instance &inst = it->second.instances.back();
+    if (inst.end == ALIVE)
+        inst.end = d_moves.size();
+}
+
+void Layout::release(std::string const &scope)
+{
+    for (auto &[name, var]: d_vars)
+    {
+        if (var.scope == scope && !var.instances.empty() && var.instances.back().end == ALIVE)
+            var.instances.back().end = d_moves.size();
+    }
+}
+
+void Layout::record(std::string const &bf, int const endPointer)
+{
+    // Follow the pointer through the code and record where each sequence of
+    // moves ends. Unbalanced loops (used to index arrays at runtime) are assumed
+    // to leave the pointer where it was, as if indexing the first element.
+
+    std::vector<int> loops;
+    int pointer = d_pointer;
+    for (size_t idx = 0; idx != bf.size(); ++idx)
+    {
+        char const c = bf[idx];
+        if (c == '>')
+            ++pointer;
+        else if (c == '<')
+            --pointer;
+        else if (c == '[')
+            loops.push_back(pointer);
+        else if (c == ']')
+        {
+            pointer = loops.back();
+            loops.pop_back();
+        }
+
+        bool const move = (c == '>' || c == '<');
+        bool const last = (idx + 1 == bf.size() || (bf[idx + 1] != '>' && bf[idx + 1] != '<'));
+        if (!move || !last || pointer < 0)
+            continue;
+
+        int const depth = std::min(d_depth + (int)loops.size(), MAX_DEPTH);
+        long const weight = 1L << (3 * depth);
+        d_travel += std::abs(pointer - d_pointer) * weight;
+        d_pointer = pointer;
+
+        if (d_recording)
+            d_moves.push_back({pointer, weight});
+    }
+
+    d_pointer = endPointer;
+}
+
+void Layout::beginLoop()
+{
+    ++d_depth;
+}
+
+void Layout::endLoop()
+{
+    assert(d_depth > 0 && "unbalanced runtime loops");
+    --d_depth;
+}
+
+Layout::Checkpoint Layout::checkpoint() const
+{
+    return {d_moves.size(), d_depth, d_travel, d_pointer};
+}
+
+void Layout::rollback(Checkpoint const &cp)
+{
+    // Code generated after the checkpoint was discarded, so the moves it made
+    // are forgotten, as are the variables declared in it.
+    d_depth = cp.depth;
+    d_travel = cp.travel;
+    d_pointer = cp.pointer;
+    if (!d_recording)
+        return;
+    
+    d_moves.resize(cp.moves);
+    for (auto &[name, var]: d_vars)
+    {
+        std::erase_if(var.instances, [&](Instance const &inst){
+                                         return inst.begin > cp.moves;
+                                     });
+        if (!var.instances.empty() && var.instances.back().end != ALIVE &&
+            var.instances.back().end > cp.moves)
+            var.instances.back().end = ALIVE;
+    }
+}
+
+long Layout::gain(Variable const &var, int const cellsRequired) const
+{
+    // Compute the reduction in pointer travel when the variable is moved to the
+    // end of the tape and everything behind it shifts down to fill the gap.
+    
+    long result = 0;
+    for (Instance const &inst: var.instances)
+    {
+        int const begin = inst.addr;
+        int const end = inst.addr + var.size;
+        auto const relocate = [&](int const addr) -> int
+                              {
+                                  if (addr < begin) return addr;
+                                  if (addr >= end)  return addr - var.size;
+                                  return cellsRequired - var.size + (addr - begin);
+                              };
+
+        size_t const last = std::min(inst.end, d_moves.size());
+        for (size_t idx = std::max(inst.begin, (size_t)1); idx < last; ++idx)
+        {
+            int const from = d_moves[idx - 1].addr;
+            int const to = d_moves[idx].addr;
+            long const before = std::abs(to - from);
+            long const after = std::abs(relocate(to) - relocate(from));
+            result += (before - after) * d_moves[idx].weight;
+        }
+    }
+
+    return result;
+}
+
+bool Layout::optimize(int const cellsRequired)
+{
+    d_recording = false;
+    d_cold.clear();
+
+    int coldSize = 0;
+    for (auto const &[name, var]: d_vars)
+    {
+        if (gain(var, cellsRequired) > 0)
+        {
+            d_cold.insert({name, var.size});
+            coldSize += var.size;
+        }
+    }
+
+    d_coldBase = cellsRequired - coldSize;
+    d_moves.clear();
+    d_moves.shrink_to_fit();
+    return !d_cold.empty();
+}
+
+int Layout::start(std::string const &ident, std::string const &scope) const
+{
+    return d_cold.contains(key(ident, scope)) ? d_coldBase : 0;
+}
+
+int Layout::relocated() const
+{
+    int result = 0;
+    for (auto const &pr: d_cold)
+        result += pr.second;
+    return result;
+}
+
+long Layout::travel() const
+{
+    return d_travel;
+}
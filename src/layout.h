@@ -0,0 +1,84 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <string>
+#include <vector>
+#include <map>
+
+// Layout decides where variables are placed on the tape. During a first code
+// generation pass, every move of the pointer is recorded, weighted by the number
+// of loops it is nested in (both in the program and in the generated BF-code, e.g.
+// the body of a copy-loop is executed as many times as the value being copied).
+// Afterwards, the effect of moving a block of
+// memory (array or struct) to the end of the tape is computed from the recorded
+// moves made while this block was alive: moves across the block become shorter,
+// moves into it become longer. Blocks for which this reduces the total pointer
+// travel are placed in a separate region at the end of the tape in the next pass.
+
+class Layout
+{
+public:
+    struct Checkpoint
+    {
+        size_t moves;
+        int    depth;
+        long   travel;
+        int    pointer;
+    };
+
+private:
+    struct Move
+    {
+        int  addr;
+        long weight;
+    };
+
+    struct Instance
+    {
+        int    addr;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Variable
+    {
+        std::string           scope;
+        int                   size;
+        std::vector<Instance> instances;
+    };
+
+    static constexpr int    MAX_DEPTH = 8;
+    static constexpr int    MIN_SIZE  = 2;
+    static constexpr size_t ALIVE     = -1;
+
+    std::vector<Move>               d_moves;
+    std::map<std::string, Variable> d_vars; // scope::ident -> variable
+    std::map<std::string, int>      d_cold; // scope::ident -> size
+    int  d_depth{0};
+    int  d_pointer{0};
+    long d_travel{0};
+    int  d_coldBase{0};
+    bool d_recording{true};
+
+public:
+    void declare(std::string const &ident, std::string const &scope, int const addr, int const size);
+    void release(std::string const &ident, std::string const &scope);
+    void release(std::string const &scope);
+    void record(std::string const &bf, int const endPointer);
+    void beginLoop();
+    void endLoop();
+
+    Checkpoint checkpoint() const;
+    void rollback(Checkpoint const &cp);
+    
+    bool optimize(int const cellsRequired);
+    int  start(std::string const &ident, std::string const &scope) const;
+    int  relocated() const;
+    long travel() const;
+
+private:
+    static std::string key(std::string const &ident, std::string const &scope);
+    long gain(Variable const &var, int const cellsRequired) const;
+};
+
+#endif //LAYOUT_H
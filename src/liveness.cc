@@ -0,0 +1,285 @@
+#include "liveness.ih"
+
+void Liveness::event(Event const e, size_t const payload)
+{
+    size_t const code = payload * 8 + e;
+    if (d_pass == Pass::RECORD)
+    {
+        d_log.push_back(code);
+        return;
+    }
+
+    if (d_logPos == d_log.size() || d_log[d_logPos] != code)
+    {
+        throw Divergence{};
+    }
+
+    ++d_logPos;
+}
+
+size_t Liveness::owner(int const addr) const
+{
+    auto it = d_owner.upper_bound(addr);
+    if (it == d_owner.begin())
+        return NONE;
+
+    --it;
+    Variable const &var = d_vars[it->second];
+    return (addr < var.addr + var.size) ? it->second : NONE;
+}
+
+void Liveness::declare(std::string const &ident, std::string const &scope, int const addr, int const size)
+{
+    size_t const idx = d_declared++;
+    if (d_pass == Pass::RECORD)
+    {
+        d_vars.push_back({ident, scope, addr, size, d_clock});
+    }
+    else
+    {
+        if (idx == d_vars.size() ||
+            d_vars[idx].ident != ident || d_vars[idx].scope != scope || d_vars[idx].size != size)
+            throw Divergence{};
+
+        d_vars[idx].addr = addr;
+        if (!d_vars[idx].pinned)
+            d_pending.insert({d_vars[idx].lastUse, idx});
+    }
+
+    event(DECLARE, std::hash<std::string>{}(scope + "::" + ident) % (NONE / 8));
+
+    // Cells that used to belong to other variables now belong to this one
+    auto it = d_owner.lower_bound(addr);
+    if (it != d_owner.begin())
+    {
+        auto const prev = std::prev(it);
+        if (prev->first + d_vars[prev->second].size > addr)
+            it = prev;
+    }
+
+    while (it != d_owner.end() && it->first < addr + size)
+        it = d_owner.erase(it);
+
+    d_owner[addr] = idx;
+}
+
+void Liveness::use(int const addr)
+{
+    bool const target = std::exchange(d_storing, false);
+    size_t const idx = owner(addr);
+    event(USE, idx);
+
+    if (idx == NONE)
+        return;
+
+    if (d_pass == Pass::APPLY)
+    {
+        if (d_isFreed[idx])
+            throw Divergence{};
+        return;
+    }
+
+    d_vars[idx].lastUse = d_clock;
+    if (!target)
+    {
+        d_vars[idx].read = true;
+        unread([&](size_t const var){ return var == idx; }, false);
+    }
+}
+
+void Liveness::beginStore()
+{
+    // The next use is the variable that is stored to, which is not a read.
+    d_storing = true;
+}
+
+void Liveness::endStore()
+{
+    d_storing = false;
+}
+
+bool Liveness::store(int const addr, int const size)
+{
+    size_t const idx = owner(addr);
+    size_t const count = d_storeCount++;
+    event(STORE, idx);
+
+    if (d_pass == Pass::APPLY)
+        return d_stores[count].dead;
+
+    d_stores.push_back({idx, false});
+    if (idx != NONE)
+    {
+        // A previous store to the same cells that was never read is overwritten
+        auto const [it, inserted] = d_unread.insert({{addr, size}, count});
+        if (!inserted)
+        {
+            d_stores[it->second].dead = true;
+            it->second = count;
+        }
+    }
+
+    return false;
+}
+
+void Liveness::boundary()
+{
+    // Control flow: stores that were not read yet might be read elsewhere.
+    d_unread.clear();
+}
+
+void Liveness::unread(std::function<bool(size_t)> const &pred, bool const dead)
+{
+    std::erase_if(d_unread, [&](auto const &pr){
+                                Store &store = d_stores[pr.second];
+                                if (!pred(store.var))
+                                    return false;
+
+                                store.dead = store.dead || dead;
+                                return true;
+                            });
+}
+
+void Liveness::pin(int const addr)
+{
+    size_t const idx = owner(addr);
+    if (idx != NONE && d_pass == Pass::RECORD)
+        d_vars[idx].pinned = true;
+}
+
+void Liveness::uninitialized(int const addr)
+{
+    // An uninitialized variable in a runtime loop carries its value over to the
+    // next iteration, so it has to stay alive.
+    if (!d_loops.empty())
+        pin(addr);
+}
+
+void Liveness::release(int const addr)
+{
+    d_owner.erase(addr);
+}
+
+void Liveness::release(std::string const &scope)
+{
+    // Values stored to variables that go out of scope before being read, are lost
+    if (d_pass == Pass::RECORD)
+        unread([&](size_t const var){
+                   return d_vars[var].scope == scope && !d_vars[var].pinned;
+               }, true);
+    
+    std::erase_if(d_owner, [&](auto const &pr){
+                               return d_vars[pr.second].scope == scope;
+                           });
+}
+
+void Liveness::beginStatement()
+{
+    ++d_clock;
+    event(BEGIN_STATEMENT);
+}
+
+std::vector<Liveness::Variable> Liveness::endStatement()
+{
+    ++d_clock;
+    event(END_STATEMENT);
+
+    std::vector<Variable> result;
+    if (d_pass == Pass::RECORD || !d_release)
+        return result;
+
+    while (!d_pending.empty() && d_pending.begin()->first < d_clock)
+    {
+        size_t const idx = d_pending.begin()->second;
+        d_pending.erase(d_pending.begin());
+
+        auto const it = d_owner.find(d_vars[idx].addr);
+        if (d_isFreed[idx] || it == d_owner.end() || it->second != idx)
+            continue;
+
+        d_owner.erase(it);
+        d_isFreed[idx] = true;
+        d_freed.push_back(idx);
+        result.push_back(d_vars[idx]);
+    }
+
+    return result;
+}
+
+void Liveness::beginLoop()
+{
+    event(BEGIN_LOOP);
+    d_loops.push_back({d_clock, d_declared});
+}
+
+void Liveness::endLoop()
+{
+    event(END_LOOP);
+    auto const [start, declared] = d_loops.back();
+    d_loops.pop_back();
+
+    if (d_pass == Pass::APPLY)
+        return;
+
+    // Variables declared before a runtime loop and used inside of it, have to
+    // be kept alive until the loop has finished.
+    for (size_t idx = 0; idx != declared; ++idx)
+    {
+        if (d_vars[idx].lastUse >= start)
+            d_vars[idx].lastUse = d_clock;
+    }
+}
+
+Liveness::Checkpoint Liveness::checkpoint() const
+{
+    return {d_owner, d_unread, d_freed.size()};
+}
+
+void Liveness::rollback(Checkpoint const &cp)
+{
+    event(ROLLBACK);
+    d_owner = cp.owner;
+    d_unread = cp.unread;
+    while (d_freed.size() > cp.freed)
+    {
+        size_t const idx = d_freed.back();
+        d_freed.pop_back();
+        d_isFreed[idx] = false;
+        d_pending.insert({d_vars[idx].lastUse, idx});
+    }
+}
+
+void Liveness::apply(bool const release)
+{
+    assert(d_pass == Pass::RECORD && "Liveness::apply() called twice");
+    assert(d_loops.empty() && "unbalanced runtime loops");
+
+    // Variables that are never read don't need any of their stores. Pinned
+    // variables might be read without being used by name (e.g. copied back to
+    // the argument of a function called out-of-line).
+    for (Store &store: d_stores)
+    {
+        if (store.var != NONE && !d_vars[store.var].pinned && !d_vars[store.var].read)
+            store.dead = true;
+    }
+
+    d_pass = Pass::APPLY;
+    d_release = release;
+    d_clock = 0;
+    d_declared = 0;
+    d_logPos = 0;
+    d_storeCount = 0;
+    d_unread.clear();
+    d_owner.clear();
+    d_isFreed.assign(d_vars.size(), false);
+}
+
+bool Liveness::applying() const
+{
+    return d_pass == Pass::APPLY;
+}
+
+bool Liveness::complete() const
+{
+    return d_logPos == d_log.size();
+}
@@ -0,0 +1,122 @@
+#ifndef LIVENESS_H
+#define LIVENESS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <functional>
+
+// Liveness records the live ranges of the variables in a program during a first
+// code generation pass. In the second pass, variables are released as soon as
+// they have been used for the last time, such that their cells can be reused by
+// other variables or temporaries. Live ranges are measured on a clock that ticks
+// at the beginning and end of every statement.
+//
+// Every event that affects liveness is logged during the first pass. The second
+// pass checks that it follows exactly the same path; if it does not (e.g. because
+// a constant could no longer be evaluated) a Divergence is thrown.
+//
+// Stores to variables are numbered in the order they are generated. A store is
+// dead when the variable is never read at all, or when the same cells are stored
+// to again (or go out of scope) before they are read, without any control flow
+// in between. The second pass can leave out the code of these stores.
+
+class Liveness
+{
+public:
+    struct Divergence
+    {};
+
+    struct Variable
+    {
+        std::string ident;
+        std::string scope;
+        int  addr;
+        int  size;
+        long lastUse;
+        bool pinned{false};
+        bool read{false};
+    };
+
+    struct Checkpoint
+    {
+        std::map<int, size_t> owner;
+        std::map<std::pair<int, int>, size_t> unread;
+        size_t freed;
+    };
+
+private:
+    enum class Pass
+        {
+         RECORD,
+         APPLY
+        };
+
+    enum Event
+        {
+         DECLARE,
+         USE,
+         BEGIN_STATEMENT,
+         END_STATEMENT,
+         BEGIN_LOOP,
+         END_LOOP,
+         ROLLBACK,
+         STORE
+        };
+
+    struct Store
+    {
+        size_t var;
+        bool   dead;
+    };
+
+    static constexpr size_t NONE = -1;
+
+    Pass   d_pass{Pass::RECORD};
+    long   d_clock{0};
+    size_t d_declared{0};
+    size_t d_logPos{0};
+    size_t d_storeCount{0};
+    bool   d_release{true};
+    bool   d_storing{false};
+
+    std::vector<Variable>                  d_vars;
+    std::vector<size_t>                    d_log;
+    std::map<int, size_t>                  d_owner;   // start address -> variable
+    std::vector<std::pair<long, size_t>>   d_loops;   // clock and #declarations at start
+    std::set<std::pair<long, size_t>>      d_pending; // variables to be released (APPLY)
+    std::vector<size_t>                    d_freed;
+    std::vector<bool>                      d_isFreed;
+    std::vector<Store>                     d_stores;
+    std::map<std::pair<int, int>, size_t>  d_unread;  // cells stored to -> store (RECORD)
+
+public:
+    void declare(std::string const &ident, std::string const &scope, int const addr, int const size);
+    void use(int const addr);
+    void beginStore();
+    void endStore();
+    bool store(int const addr, int const size);
+    void boundary();
+    void pin(int const addr);
+    void uninitialized(int const addr);
+    void release(int const addr);
+    void release(std::string const &scope);
+    void beginStatement();
+    std::vector<Variable> endStatement();
+    void beginLoop();
+    void endLoop();
+
+    Checkpoint checkpoint() const;
+    void rollback(Checkpoint const &cp);
+    void apply(bool const release = true);
+    bool applying() const;
+    bool complete() const;
+
+private:
+    void event(Event const e, size_t const payload = 0);
+    size_t owner(int const addr) const;
+    void unread(std::function<bool(size_t)> const &pred, bool const dead);
+};
+
+#endif //LIVENESS_H
@@ -19,13 +19,36 @@ void printHelp(std::string const &progName)
               << "--max-unroll-iterations [N]\n"
               << "                    Specify the maximum number of loop-iterations that will be unrolled.\n"
               << "                      Defaults to 20.\n"
+              << "--optimize-for [Policy]\n"
+              << "                    Decide per loop whether to unroll it, based on the estimated size\n"
+              << "                      and runtime of the result. [Policy] is one of size, speed\n"
+              << "                      and balanced (default).\n"
+              << "--outline [function]\n"
+              << "                    Generate the body of [function] only once and call it out-of-line,\n"
+              << "                      trading runtime for code size. May appear multiple times.\n"
+              << "--outline-threshold [N]\n"
+              << "                    Call every function out-of-line whose body expands to at least N\n"
+              << "                      instructions and is called more than once.\n"
+              << "--partial-eval [N]  Run the program at compile time for at most N steps, up to the first\n"
+              << "                      input. The output and memory state at that point are generated\n"
+              << "                      directly, so the program starts where the evaluation stopped.\n"
               << "--test [file]       Produce test-files and write a list of generated files to [file], to\n"
               << "                      be used by bfint for unit-testing.\n"
               << "--random            Enable random number generation (generates the ?-symbol).\n"
               << "                      Your interpreter must support this extension!\n"
               << "--profile [file]    Write the memory profile to a file. In this file, the number of visits\n"
               << "                      to each of the cells is listed.\n"
+              << "--source-map [file] Write a map from ranges of the BF-code to the source lines (and the\n"
+              << "                      functions they were inlined into) that generated them, to be\n"
+              << "                      used by bfint --profile-out.\n"
               << "--no-bcr            Disable break/continue/return statements for more compact output.\n"
+              << "--no-memory-reuse   Do not reuse the cells of variables that are no longer used.\n"
+              << "--no-cell-layout    Do not relocate variables to reduce pointer movement.\n"
+              << "--no-dead-store-elimination\n"
+              << "                    Generate code for stores to variables that are never read.\n"
+              << "--dead-store-warning\n"
+              << "                    Warn about every store that was eliminated because its value is\n"
+              << "                      never read.\n"
               << "--no-multiple-inclusion-warning\n"
               << "                    Do not warn when a file is included more than once, or when files \n"
               << "                      with duplicate names are included.\n"
@@ -144,6 +167,76 @@ std::pair<Compiler::Options, int> parseCmdLine(std::vector<std::string> const &a
                 return {opt, 1};
             }
         }
+        else if (args[idx] == "--optimize-for")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No argument passed to option \'--optimize-for\'.\n";
+                return {opt, 1};
+            }
+
+            static std::map<std::string, Compiler::OptimizeFor> const getPolicy{
+                {"balanced", Compiler::OptimizeFor::BALANCED},
+                {"size", Compiler::OptimizeFor::SIZE},
+                {"speed", Compiler::OptimizeFor::SPEED}
+            };
+
+            auto const it = getPolicy.find(args[idx + 1]);
+            if (it == getPolicy.end())
+            {
+                std::cerr << "ERROR: Invalid argument passed to option \'--optimize-for\'. "
+                          << "Choose from size, speed or balanced.\n";
+                return {opt, 1};
+            }
+
+            opt.optimizeFor = it->second;
+            idx += 2;
+        }
+        else if (args[idx] == "--outline")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No function passed to option \'--outline\'.\n";
+                return {opt, 1};
+            }
+
+            opt.outlined.push_back(args[idx + 1]);
+            idx += 2;
+        }
+        else if (args[idx] == "--outline-threshold")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No argument passed to option \'--outline-threshold\'.\n";
+                return {opt, 1};
+            }
+            
+            try {
+                opt.outlineThreshold = std::stoi(args[idx + 1]);
+                idx += 2;
+            }
+            catch (...) {
+                std::cerr << "Could not convert argument to --outline-threshold to integer.";
+                return {opt, 1};
+            }
+        }
+        else if (args[idx] == "--partial-eval")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No argument passed to option \'--partial-eval\'.\n";
+                return {opt, 1};
+            }
+            
+            try {
+                opt.partialEvalBudget = std::stol(args[idx + 1]);
+                idx += 2;
+            }
+            catch (...) {
+                std::cerr << "Could not convert argument to --partial-eval to integer.";
+                return {opt, 1};
+            }
+        }
         else if (args[idx] == "--test")
         {
             if (idx == args.size() - 1)
@@ -173,11 +266,42 @@ std::pair<Compiler::Options, int> parseCmdLine(std::vector<std::string> const &a
             idx += 2;
 
         }
+        else if (args[idx] == "--source-map")
+        {
+            if (idx == args.size() - 1)
+            {
+                std::cerr << "ERROR: No filename passed to option \'--source-map\'.\n";
+                return {opt, 1};
+            }
+
+            opt.sourceMapFile = args[idx + 1];
+            idx += 2;
+        }
         else if (args[idx] == "--no-bcr")
         {
             opt.bcrEnabled = false;
             ++idx;
         }
+        else if (args[idx] == "--no-memory-reuse")
+        {
+            opt.memoryReuseEnabled = false;
+            ++idx;
+        }
+        else if (args[idx] == "--no-cell-layout")
+        {
+            opt.cellLayoutEnabled = false;
+            ++idx;
+        }
+        else if (args[idx] == "--no-dead-store-elimination")
+        {
+            opt.deadStoreEliminationEnabled = false;
+            ++idx;
+        }
+        else if (args[idx] == "--dead-store-warning")
+        {
+            opt.deadStoreWarningEnabled = true;
+            ++idx;
+        }
         else if (args[idx] == "--no-multiple-inclusion-warning")
         {
             opt.includeWarningEnabled = false;
@@ -1,4 +1,5 @@
 #include "memory.h"
+#include <algorithm>
 
 void Memory::Cell::clear()
 {
@@ -10,9 +11,13 @@ void Memory::Cell::clear()
     synced = false;
 }
         
-int Memory::findFree(int const sz)
+int Memory::findFree(int const sz, int const begin)
 {
-    for (size_t start = 0; start != d_memory.size() - sz; ++start)
+    int const first = std::max(begin, d_floor);
+    if (first + sz > (int)d_memory.size())
+        d_memory.resize(first + sz);
+    
+    for (size_t start = first; start != d_memory.size() - sz; ++start)
     {
         bool done = true;
         for (int offset = 0; offset != sz; ++offset)
@@ -28,7 +33,7 @@ int Memory::findFree(int const sz)
     }
     
     d_memory.resize(d_memory.size() + sz);
-    return findFree(sz);
+    return findFree(sz, begin);
 }
 
 int Memory::getTemp(std::string const &scope, TypeSystem::Type type)
@@ -36,14 +41,50 @@ int Memory::getTemp(std::string const &scope, TypeSystem::Type type)
     return allocate("", scope, type);
 }
 
-int Memory::getTemp(std::string const &scope, int const sz)
+int Memory::findNear(int const sz, int const hint)
+{
+    // Find the free block of sz cells that starts closest to the hint. All
+    // cells beyond d_maxAddr are free, so the search can stop there. Cells below
+    // the floor are not available.
+
+    int const end = std::max(std::min((int)d_memory.size(), d_maxAddr), d_floor);
+    int best = -1;
+    int runStart = d_floor;
+    for (int idx = d_floor; idx <= end; ++idx)
+    {
+        if (idx < end && d_memory[idx].empty())
+            continue;
+
+        if (idx - runStart >= sz || idx == end)
+        {
+            int const candidate = (idx == end) ? runStart : std::clamp(hint, runStart, idx - sz);
+            if (best == -1 || std::abs(candidate - hint) < std::abs(best - hint))
+                best = candidate;
+        }
+        
+        runStart = idx + 1;
+    }
+
+    if (best + sz > (int)d_memory.size())
+        d_memory.resize(best + sz);
+    
+    return best;
+}
+
+int Memory::getTemp(std::string const &scope, int const sz, int const hint)
 {
-    return getTemp(scope, TypeSystem::Type(sz));
+    if (hint < 0)
+        return getTemp(scope, TypeSystem::Type(sz));
+
+    return claim(findNear(sz, hint), "", scope, TypeSystem::Type(sz));
 }
 
-int Memory::getTempBlock(std::string const &scope, int const sz)
+int Memory::getTempBlock(std::string const &scope, int const sz, int const hint)
 {
-    int start = findFree(sz);
+    int start = (hint < 0) ? findFree(sz) : findNear(sz, hint);
+    if (start + sz > d_maxAddr)
+        d_maxAddr = start + sz;
+    
     for (int i = 0; i != sz; ++i)
     {
         Cell &cell = d_memory[start + i];
@@ -56,14 +97,18 @@ int Memory::getTempBlock(std::string const &scope, int const sz)
     return start;
 }
 
-int Memory::allocate(std::string const &ident, std::string const &scope, TypeSystem::Type type)
+int Memory::allocate(std::string const &ident, std::string const &scope, TypeSystem::Type type, int const start)
 {
     assert(type.defined() && "Trying to allocate undefined type");
 
     if (!ident.empty() && find(ident, scope, false) != -1)
         return  -1;
 
-    int const addr = findFree(type.size());
+    return claim(findFree(type.size(), start), ident, scope, type);
+}
+
+int Memory::claim(int const addr, std::string const &ident, std::string const &scope, TypeSystem::Type type)
+{
     if (addr + type.size() > d_maxAddr)
         d_maxAddr = addr + type.size();
     
@@ -239,6 +284,16 @@ void Memory::freeLocals(std::string const &scope)
         );
 }
 
+void Memory::free(int const addr)
+{
+    assert(addr >= 0 && addr < (int)d_memory.size() && "address out of bounds");
+    Cell &cell = d_memory[addr];
+    for (int offset = 1; offset < cell.size(); ++offset)
+        d_memory[addr + offset].clear();
+
+    cell.clear();
+}
+
 int Memory::sizeOf(int const addr) const
 {
     assert(addr >= 0 && addr < (int)d_memory.size() && "address out of bounds");
@@ -290,6 +345,11 @@ bool Memory::isTemp(int const addr) const
     return d_memory[addr].content == Content::TEMP;
 }
 
+bool Memory::isEmpty(int const addr) const
+{
+    return addr < 0 || addr >= (int)d_memory.size() || d_memory[addr].empty();
+}
+
 TypeSystem::Type Memory::type(int const addr) const
 {
     assert(addr >= 0 && addr < (int)d_memory.size() && "address out of bounds");
@@ -362,6 +422,30 @@ std::vector<int> Memory::cellsInScope(std::string const &scope) const
 }
 
 
+void Memory::reserve(int const begin, int const end, std::string const &scope)
+{
+    // Claim all free cells in [begin, end) for the rest of the program
+    if (end > (int)d_memory.size())
+        d_memory.resize(end);
+
+    for (int addr = begin; addr != end; ++addr)
+    {
+        if (d_memory[addr].empty())
+            claim(addr, scope, scope, TypeSystem::Type(1));
+    }
+}
+
+void Memory::setFloor(int const addr)
+{
+    // While a floor is set, nothing is allocated below it
+    d_floor = addr;
+}
+
+int Memory::floor() const
+{
+    return d_floor;
+}
+
 void Memory::dump() const
 {
     static std::string const contentStrings[] =
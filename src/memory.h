@@ -53,6 +53,7 @@ private:
     std::map<int, std::vector<std::pair<std::string, std::string>>> d_aliasMap;
     
     int d_maxAddr{0};
+    int d_floor{0};
     
 public:
     Memory(size_t sz):
@@ -61,9 +62,9 @@ public:
 
     size_t size() const;
     int getTemp(std::string const &scope, TypeSystem::Type type);
-    int getTemp(std::string const &scope, int const sz = 1);
-    int getTempBlock(std::string const &scope, int const sz);
-    int allocate(std::string const &ident, std::string const &scope, TypeSystem::Type type);
+    int getTemp(std::string const &scope, int const sz = 1, int const hint = -1);
+    int getTempBlock(std::string const &scope, int const sz, int const hint = -1);
+    int allocate(std::string const &ident, std::string const &scope, TypeSystem::Type type, int const start = 0);
     void addAlias(int const addr, std::string const &ident, std::string const &scope);
     void removeAlias(int const addr, std::string const &ident, std::string const &scope);
     
@@ -72,9 +73,11 @@ public:
     int sizeOf(std::string const &ident, std::string const &scope) const;
     void freeTemps(std::string const &scope);
     void freeLocals(std::string const &scope);
+    void free(int const addr);
     void markAsTemp(int const addr);
     void rename(int const addr, std::string const &ident, std::string const &scope);
     bool isTemp(int const addr) const;
+    bool isEmpty(int const addr) const;
     int value(int const addr) const;
     int &value(int const addr);
     bool valueKnown(int const addr) const;
@@ -86,6 +89,9 @@ public:
     TypeSystem::Type type(int const addr) const;
     TypeSystem::Type type(std::string const &ident, std::string const &scope) const;
     std::vector<int> cellsInScope(std::string const &scope) const;
+    void reserve(int const begin, int const end, std::string const &scope);
+    void setFloor(int const addr);
+    int floor() const;
     size_t cellsRequired() const
     {
         return d_maxAddr;
@@ -94,7 +100,9 @@ public:
     void dump() const;
     
 private:    
-    int findFree(int sz = 1);
+    int findFree(int sz = 1, int const begin = 0);
+    int findNear(int const sz, int const hint);
+    int claim(int const addr, std::string const &ident, std::string const &scope, TypeSystem::Type type);
     void place(TypeSystem::Type type, int const addr, bool const recursive = false);
 
     template <typename Predicate>
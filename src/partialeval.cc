@@ -0,0 +1,178 @@
+#include "partialeval.ih"
+
+std::string PartialEval::process(std::string const &bf)
+{
+    d_steps = 0;
+    d_resume = 0;
+    if (d_budget <= 0)
+        return bf;
+    
+    std::vector<size_t> const match = matchBrackets(bf);
+    if (match.empty())
+        return bf;
+    
+    size_t resume = 0;
+    long resumeSteps = 0;
+    State state = run(bf, match, d_budget, resume, resumeSteps);
+    if (state.ip != resume)
+    {
+        // Stopped inside a loop -> run again, up to the last top-level instruction
+        size_t ignored;
+        long ignoredSteps;
+        state = run(bf, match, resumeSteps, ignored, ignoredSteps);
+    }
+    assert(state.ip == resume && "partial evaluation should stop at top-level instruction");
+
+    // Only worth it when the steps that are saved outnumber the steps needed to
+    // initialize the tape and reproduce the output.
+    std::string const result = residual(state, bf);
+    if ((long)(result.size() + resume) - (long)bf.size() >= state.steps)
+        return bf;
+
+    d_steps = state.steps;
+    d_resume = resume;
+    return result;
+}
+
+bool PartialEval::isInstruction(char const c)
+{
+    static std::string const instructions = "+-<>[].,?";
+    return instructions.find(c) != std::string::npos;
+}
+
+std::vector<size_t> PartialEval::matchBrackets(std::string const &bf)
+{
+    std::vector<size_t> match(bf.size());
+    std::vector<size_t> stack;
+    for (size_t idx = 0; idx != bf.size(); ++idx)
+    {
+        if (bf[idx] == '[')
+            stack.push_back(idx);
+        else if (bf[idx] == ']')
+        {
+            if (stack.empty())
+                return {};
+            
+            match[idx] = stack.back();
+            match[stack.back()] = idx;
+            stack.pop_back();
+        }
+    }
+
+    return stack.empty() ? match : std::vector<size_t>{};
+}
+
+PartialEval::State PartialEval::run(std::string const &bf, std::vector<size_t> const &match,
+                                    long const budget, size_t &resume, long &resumeSteps) const
+{
+    long const mod = d_maxValue + 1;
+    State state;
+    state.tape.resize(1);
+
+    int depth = 0;
+    while (state.ip != bf.size())
+    {
+        if (!isInstruction(bf[state.ip]))
+        {
+            ++state.ip;
+            continue;
+        }
+        
+        if (depth == 0)
+        {
+            resume = state.ip;
+            resumeSteps = state.steps;
+        }
+
+        char const c = bf[state.ip];
+        if (c == ',' || c == '?' || state.steps == budget)
+            return state;
+
+        long &cell = state.tape[state.pointer];
+        switch (c)
+        {
+        case '+': cell = (cell + 1) % mod; break;
+        case '-': cell = (cell + mod - 1) % mod; break;
+        case '.': state.output.push_back(cell); break;
+        case '<':
+            {
+                if (state.pointer == 0)
+                    return state;
+
+                --state.pointer;
+                break;
+            }
+        case '>':
+            {
+                if (state.pointer + 1 == MAX_CELLS)
+                    return state;
+                
+                if (++state.pointer == (long)state.tape.size())
+                    state.tape.push_back(0);
+                break;
+            }
+        case '[':
+            {
+                if (cell == 0)
+                    state.ip = match[state.ip];
+                else
+                    ++depth;
+                break;
+            }
+        case ']':
+            {
+                if (cell != 0)
+                    state.ip = match[state.ip];
+                else
+                    --depth;
+                break;
+            }
+        default: break;
+        }
+
+        ++state.ip;
+        ++state.steps;
+    }
+
+    resume = state.ip;
+    resumeSteps = state.steps;
+    return state;
+}
+
+std::string PartialEval::residual(State const &state, std::string const &bf) const
+{
+    // The output is printed from cell 0, which is then restored to zero before
+    // the tape is initialized.
+    
+    std::string result;
+    long previous = 0;
+    for (long const value: state.output)
+    {
+        result += shortestDelta(previous, value) + '.';
+        previous = value;
+    }
+    result += shortestDelta(previous, 0);
+
+    long pointer = 0;
+    for (long idx = 0; idx != (long)state.tape.size(); ++idx)
+    {
+        if (state.tape[idx] == 0)
+            continue;
+
+        result += std::string(idx - pointer, '>') + shortestDelta(0, state.tape[idx]);
+        pointer = idx;
+    }
+
+    result += (state.pointer > pointer) ?
+        std::string(state.pointer - pointer, '>') :
+        std::string(pointer - state.pointer, '<');
+
+    return result + bf.substr(state.ip);
+}
+
+std::string PartialEval::shortestDelta(long const from, long const to) const
+{
+    long const mod = d_maxValue + 1;
+    long const diff = (((to - from) % mod) + mod) % mod;
+    return (diff <= mod - diff) ? std::string(diff, '+') : std::string(mod - diff, '-');
+}
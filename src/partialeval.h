@@ -0,0 +1,68 @@
+#ifndef PARTIALEVAL_H
+#define PARTIALEVAL_H
+
+#include <string>
+#include <vector>
+
+// PartialEval runs the opening stretch of a generated program at compile time, up
+// to the first instruction that reads input (or generates a random number), or
+// until the step budget is exhausted. Execution can only be resumed at the top
+// level of the program (outside of all loops), so the last top-level instruction
+// that was reached is taken as the point where the residual program continues. The
+// code before this point is replaced by code that prints the output it produced
+// and initializes the tape to its state at that point.
+
+class PartialEval
+{
+    struct State
+    {
+        std::vector<long> tape;
+        std::vector<long> output;
+        size_t            ip{0};
+        long              pointer{0};
+        long              steps{0};
+    };
+
+    static constexpr long MAX_CELLS = 1 << 20;
+    
+    long const d_maxValue;
+    long const d_budget;
+    long       d_steps{0};
+    size_t     d_resume{0};
+
+public:
+    PartialEval(long const maxValue, long const budget):
+        d_maxValue(maxValue),
+        d_budget(budget)
+    {}
+
+    std::string process(std::string const &bf);
+    long budget() const;
+    long steps() const;
+    size_t resumed() const;
+
+private:
+    static bool isInstruction(char const c);
+    static std::vector<size_t> matchBrackets(std::string const &bf);
+    State run(std::string const &bf, std::vector<size_t> const &match, long const budget,
+              size_t &resume, long &resumeSteps) const;
+    std::string residual(State const &state, std::string const &bf) const;
+    std::string shortestDelta(long const from, long const to) const;
+};
+
+inline long PartialEval::budget() const
+{
+    return d_budget;
+}
+
+inline long PartialEval::steps() const
+{
+    return d_steps;
+}
+
+inline size_t PartialEval::resumed() const
+{
+    return d_resume;
+}
+
+#endif //PARTIALEVAL_H
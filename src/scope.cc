@@ -11,6 +11,15 @@ std::string Scope::function() const
     return empty() ? "" : d_stack.back().first;
 }
 
+std::vector<std::string> Scope::functions() const
+{
+    std::vector<std::string> result;
+    for (auto const &item: d_stack)
+        result.push_back(item.first);
+
+    return result;
+}
+
 std::string Scope::current() const
 {
     std::string result = function();
@@ -61,10 +70,9 @@ std::string Scope::popFunction(std::string const &name)
 
 void Scope::push(Type type)
 {
-    static int counter = 0;
     d_stack.back().second.push_back({
                              .type = type,
-                             .id   = ++counter
+                             .id   = ++d_counter
         });
 }
 
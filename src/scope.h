@@ -4,6 +4,7 @@
 #include <deque>
 #include <string>
 #include <utility>
+#include <vector>
 
 class Scope
 {
@@ -29,10 +30,12 @@ private:
     };
     
     StackType<std::pair<std::string, StackType<SubScope>>> d_stack;
+    int d_counter{0};
 
 public:
     bool empty() const;
     std::string function() const;
+    std::vector<std::string> functions() const;
     std::string current() const;
     Type currentType() const;
     std::string enclosing() const;
@@ -0,0 +1,115 @@
+#include "sourcemap.ih"
+
+int SourceMap::intern(Location const &location)
+{
+    Key const key{location.file, location.line, location.stack};
+    auto const it = d_index.find(key);
+    if (it != d_index.end())
+        return it->second;
+
+    d_locations.push_back(location);
+    return (d_index[key] = d_locations.size() - 1);
+}
+
+void SourceMap::mark(size_t const offset, Location const &location)
+{
+    if (!d_enabled)
+        return;
+
+    assert((d_marks.empty() || d_marks.back().offset <= offset) && "marks out of order");
+    
+    int const idx = intern(location);
+    if (!d_marks.empty() && d_marks.back().offset == offset)
+    {
+        // Nothing was generated for the previous mark
+        d_marks.pop_back();
+    }
+
+    if (d_marks.empty() || d_marks.back().location != idx)
+        d_marks.push_back({offset, idx});
+}
+
+void SourceMap::truncate(size_t const size)
+{
+    // Code from size onwards has been removed
+    while (!d_marks.empty() && d_marks.back().offset >= size)
+        d_marks.pop_back();
+}
+
+void SourceMap::erase(size_t const pos, size_t const len)
+{
+    // Marks within the erased range now apply to the code following it; only the
+    // last of those remains.
+    std::vector<Mark> result;
+    for (Mark mark: d_marks)
+    {
+        if (mark.offset > pos)
+            mark.offset = (mark.offset >= pos + len) ? mark.offset - len : pos;
+
+        if (!result.empty() && result.back().offset == mark.offset)
+            result.pop_back();
+        
+        result.push_back(mark);
+    }
+
+    d_marks = std::move(result);
+}
+
+void SourceMap::replacePrefix(size_t const oldSize, size_t const newSize, Location const &location)
+{
+    // The first oldSize characters of the code were replaced by newSize characters
+    // generated on behalf of the given location.
+    int const first = locate(oldSize);
+    std::vector<Mark> result{{0, intern(location)}};
+    if (first != -1)
+        result.push_back({newSize, first});
+    
+    for (Mark const &mark: d_marks)
+    {
+        if (mark.offset > oldSize)
+            result.push_back({mark.offset - oldSize + newSize, mark.location});
+    }
+
+    d_marks = std::move(result);
+}
+
+int SourceMap::locate(size_t const offset) const
+{
+    auto const it = std::upper_bound(d_marks.begin(), d_marks.end(), offset,
+                                     [](size_t const off, Mark const &mark){
+                                         return off < mark.offset;
+                                     });
+
+    return (it == d_marks.begin()) ? -1 : std::prev(it)->location;
+}
+
+void SourceMap::write(std::ostream &out, std::vector<size_t> const &origin) const
+{
+    // Every character of the final program originates from a position in the code
+    // that was marked. Consecutive characters of the same location form a range.
+    out << "# begin\tend\tfile\tline\tstack\n";
+
+    size_t begin = 0;
+    int current = -1;
+    auto const flush = [&](size_t const end){
+                           if (current == -1 || end == begin)
+                               return;
+                           
+                           Location const &loc = d_locations[current];
+                           out << begin << '\t' << end << '\t' << loc.file << '\t'
+                               << loc.line << '\t' << loc.stack << '\n';
+                       };
+    
+    for (size_t idx = 0; idx != origin.size(); ++idx)
+    {
+        int const location = locate(origin[idx]);
+        if (location == current)
+            continue;
+
+        flush(idx);
+        begin = idx;
+        current = location;
+    }
+
+    flush(origin.size());
+}
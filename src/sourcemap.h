@@ -0,0 +1,63 @@
+#ifndef SOURCEMAP_H
+#define SOURCEMAP_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <tuple>
+#include <iosfwd>
+
+// SourceMap records which statement of the source generated each part of the
+// BF-code. While generating, a mark is placed whenever code is emitted on behalf of
+// a location (file, line and the chain of inlined calls leading to it) other than
+// the one of the code before it. When generated code is removed again, so are its
+// marks. The final program is written as ranges of BF-code per location to a
+// sidecar file, which bfint uses to map its runtime profile back to the source.
+
+class SourceMap
+{
+public:
+    struct Location
+    {
+        std::string file;
+        int         line;
+        std::string stack; // functions, outermost first, separated by ';'
+    };
+
+private:
+    struct Mark
+    {
+        size_t offset;
+        int    location;
+    };
+
+    using Key = std::tuple<std::string, int, std::string>;
+
+    bool                  d_enabled;
+    std::vector<Location> d_locations;
+    std::map<Key, int>    d_index;
+    std::vector<Mark>     d_marks;
+
+public:
+    SourceMap(bool const enabled = false):
+        d_enabled(enabled)
+    {}
+
+    bool enabled() const;
+    void mark(size_t const offset, Location const &location);
+    void truncate(size_t const size);
+    void erase(size_t const pos, size_t const len);
+    void replacePrefix(size_t const oldSize, size_t const newSize, Location const &location);
+    void write(std::ostream &out, std::vector<size_t> const &origin) const;
+
+private:
+    int intern(Location const &location);
+    int locate(size_t const offset) const;
+};
+
+inline bool SourceMap::enabled() const
+{
+    return d_enabled;
+}
+
+#endif //SOURCEMAP_H